@@ -0,0 +1,135 @@
+// budiv-headless: runs a script with no window, no GPU and no raylib.
+//
+//   budiv-headless script.bu [ticks] [--realtime] [--rate hz] [--threads n]
+//                  [--gc-budget us] [--intern] [--compile-limit bytes]
+//                  [--memory-dump ticks] [--memory-file path]
+//
+// ticks 0 (the default) runs until no process is left alive. Without
+// --realtime the clock is simulated and ticks run back to back, which is
+// what benchmarks and CI want; --realtime paces them on the wall clock.
+// --memory-dump writes a memory report, one JSON object per line, every
+// that many ticks and once at the end, to stderr or --memory-file.
+
+#include <chrono>
+#include <cstdlib>
+
+#include "Config.hpp"
+#include "VM.hpp"
+#include "Utils.hpp"
+extern GarbageCollector GC;
+
+
+static void usage()
+{
+    printf("usage: budiv-headless script.bu [ticks] [--realtime] [--rate hz] [--threads n] [--gc-budget us] [--intern] [--compile-limit bytes] [--memory-dump ticks] [--memory-file path]\n");
+}
+
+int main(int argc, char** argv)
+{
+    const char* script = nullptr;
+    u32 ticks = 0;
+    u32 rate = 0;
+    u32 threads = 0;
+    int gcBudget = -1;
+    u32 compileLimit = 0;
+    u32 memoryDump = 0;
+    const char* memoryFile = nullptr;
+    bool realtime = false;
+    bool intern = false;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--realtime") == 0)
+        {
+            realtime = true;
+        }
+        else if (strcmp(argv[i], "--intern") == 0)
+        {
+            intern = true;
+        }
+        else if (strcmp(argv[i], "--rate") == 0 && i + 1 < argc)
+        {
+            rate = (u32)atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+        {
+            threads = (u32)atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--gc-budget") == 0 && i + 1 < argc)
+        {
+            gcBudget = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--compile-limit") == 0 && i + 1 < argc)
+        {
+            compileLimit = (u32)atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--memory-dump") == 0 && i + 1 < argc)
+        {
+            memoryDump = (u32)atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--memory-file") == 0 && i + 1 < argc)
+        {
+            memoryFile = argv[++i];
+        }
+        else if (argv[i][0] == '-')
+        {
+            usage();
+            return 2;
+        }
+        else if (!script)
+        {
+            script = argv[i];
+        }
+        else
+        {
+            ticks = (u32)atoi(argv[i]);
+        }
+    }
+    if (!script)
+    {
+        usage();
+        return 2;
+    }
+
+    Interpreter vm;
+    StepClock steps;
+    if (!realtime) vm.set_clock(&steps);
+    if (rate) vm.set_tick_rate(rate);
+    if (threads) vm.set_worker_threads(threads);
+    if (gcBudget >= 0) vm.set_gc_budget((u32)gcBudget);
+    vm.set_runtime_interning(intern);
+    vm.set_compiler_memory_limit(compileLimit);
+
+    FILE* dump = nullptr;
+    if (memoryDump)
+    {
+        dump = memoryFile ? fopen(memoryFile, "w") : stderr;
+        if (!dump)
+        {
+            ERROR("Could not open %s", memoryFile);
+            return 1;
+        }
+        vm.set_memory_dump(memoryDump, dump);
+    }
+
+    vm.defineStandardNatives();
+    vm.defineInputNatives();
+
+    int result = 1;
+    if (vm.compile_file(script))
+    {
+        auto start = std::chrono::steady_clock::now();
+        u32 done = vm.run_headless(ticks);
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        INFO("%u ticks in %.2f ms (%.4f ms/tick)", done, ms, done ? ms / done : 0.0);
+        INFO("%d objects alive, %u strings interned", GC.countObjects(), GC.internedCount());
+        if (dump) vm.dump_memory(dump);
+        result = 0;
+    }
+    vm.set_memory_dump(0, nullptr);
+    if (dump && dump != stderr) fclose(dump);
+
+    vm.clear();
+    GC.collect();
+    return result;
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "Config.hpp"
+
+// Bump allocator for data that only lives while one script compiles. There
+// is no per-allocation free: release() drops everything at once and keeps
+// the first block for the next compile. With a limit set, an allocation
+// that would go past it fails (nullptr) instead of growing.
+class Arena
+{
+    struct Block
+    {
+        Block* next;
+        size_t size;
+        size_t used;
+
+        static size_t header() { return (sizeof(Block) + 15) & ~(size_t)15; }
+        u8* data() { return (u8*)this + header(); }
+    };
+
+    static const size_t BLOCK_SIZE = 64 * 1024;
+
+    Block* blocks;        // newest first; the head is the one being filled
+    size_t used;          // bytes handed out since the last release
+    size_t peak;
+    size_t reserved;      // bytes held in blocks
+    size_t limit;         // 0: no limit
+
+    Block* newBlock(size_t size);
+
+public:
+    // Position to roll back to, for scratch space inside one pass.
+    struct Mark
+    {
+        Block* block;
+        size_t blockUsed;
+        size_t used;
+    };
+
+    Arena();
+    ~Arena();
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    void* allocate(size_t size, size_t align = sizeof(void*));
+    template <typename T> T* allocate(size_t count = 1)
+    {
+        return (T*)allocate(count * sizeof(T), alignof(T));
+    }
+
+    // NUL-terminated copy of len bytes.
+    char* copy(const char* text, size_t len);
+
+    Mark mark() const;
+    void rewind(const Mark& mark);
+    void release();
+
+    void setLimit(size_t bytes) { limit = bytes; }
+    size_t bytesUsed() const { return used; }
+    size_t bytesPeak() const { return peak; }
+    size_t bytesReserved() const { return reserved; }
+};
@@ -2,9 +2,33 @@
 
 #include "Config.hpp"
 
+class Chunk;
+
+// Finished code of one compile in a single read-only block: every chunk's
+// code back to back, then every chunk's line table. Each chunk moved in
+// holds a reference and the last one to let go unmaps the block.
+struct CodeSegment
+{
+    u8* block;
+    size_t size;          // mapped bytes, whole pages
+    u32 users;
+
+    static CodeSegment* pack(Chunk** chunks, u32 count);
+    void release();
+};
+
 class Chunk
 {
     u32 m_capacity;
+    u32 lineCapacity;
+    int lastLine;         // line of the last entry in the table
+    u32 lastOffset;       // code offset where that entry starts
+
+    void addLine(u32 offset, int line);
+    bool own();
+    size_t ownedBytes() const { return segment ? 0 : (size_t)m_capacity + lineCapacity; }
+
+    friend struct CodeSegment;
 
 public:
     Chunk(u32 capacity = 512);
@@ -22,7 +46,15 @@ public:
 
     bool clone(Chunk *other);
 
+    // Source line of the instruction at offset. Walks the table, so it is
+    // meant for errors and the disassembler, not the run loop.
+    int lineAt(u32 offset) const;
+
     u8 *code;
-    int *lines;
+    // One entry per change of line: the code offset delta and the line
+    // delta (zigzag), both as varints.
+    u8 *lines;
+    u32 lineBytes;
     u32 count;
+    CodeSegment* segment; // set once the code is packed and read-only
 };
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "Config.hpp"
+
+class Process;
+
+// Built-in process fields, one dense column per field. Only spawned
+// instances own a row; Process::field is the row index. Rows are removed
+// by moving the last row into the hole, so the columns stay packed and
+// render/collision passes can walk them without touching Process objects.
+class FieldStore
+{
+public:
+    static const u32 FIELD_COUNT = 3;
+    static const u32 NO_ROW = 0xFFFFFFFF;
+
+    double* columns[FIELD_COUNT];
+    double* previous[FIELD_COUNT]; // columns as of the last save()
+    u8* status;        // mirror of Process::status
+    Process** owners;
+    u32 count;
+    u32 capacity;
+
+    FieldStore();
+    ~FieldStore();
+    FieldStore(const FieldStore&) = delete;
+    FieldStore& operator=(const FieldStore&) = delete;
+
+    u32 add(Process* owner, const double* defaults);
+    void remove(u32 row);
+    void save();
+
+    static int resolve(const char* name, size_t len);
+    static const char* name(u32 field);
+
+private:
+    bool grow();
+};
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "Config.hpp"
+
+class Process;
+
+// Process ids are handles: the low INDEX_BITS pick a slot, the rest hold
+// the slot's generation when the id was issued. A slot's generation is
+// bumped each time it is released, so a stale id never resolves to the
+// process that reused the slot. Id 0 is never issued.
+class HandleTable
+{
+public:
+    static const u32 INDEX_BITS = 20;
+    static const u32 INDEX_MASK = (1u << INDEX_BITS) - 1;
+    static const u32 GENERATION_MASK = 0xFFFFFFFFu >> INDEX_BITS;
+
+private:
+    struct Slot
+    {
+        Process* process;
+        u32 generation;
+        u32 nextFree;
+    };
+
+    static const u32 NO_SLOT = 0xFFFFFFFF;
+
+    Slot* slots;
+    u32 count;
+    u32 capacity;
+    u32 freeHead;
+    u32 freeTail;
+
+    bool grow();
+
+public:
+    HandleTable();
+    ~HandleTable();
+    HandleTable(const HandleTable&) = delete;
+    HandleTable& operator=(const HandleTable&) = delete;
+
+    u32 acquire(Process* process);
+    void release(u32 id);
+
+    Process* get(u32 id) const
+    {
+        u32 index = id & INDEX_MASK;
+        if (index >= count) return nullptr;
+        const Slot& slot = slots[index];
+        if (slot.generation != (id >> INDEX_BITS)) return nullptr;
+        return slot.process;
+    }
+};
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "Config.hpp"
+
+// Time source for the interpreter's run loops, in microseconds.
+class Clock
+{
+public:
+    virtual ~Clock() {}
+    virtual u64 now() = 0;
+    virtual void wait_until(u64 time) = 0;
+};
+
+// Wall clock. wait_until sleeps, so ticks happen in real time.
+class SystemClock : public Clock
+{
+public:
+    u64 now() override;
+    void wait_until(u64 time) override;
+};
+
+// Simulated clock. Waiting just moves time forward, so a run goes as fast
+// as the machine allows and gives the same ticks every time.
+class StepClock : public Clock
+{
+    u64 time;
+
+public:
+    StepClock(): time(0) {}
+    u64 now() override { return time; }
+    void wait_until(u64 until) override { if (until > time) time = until; }
+};
+
+
+// Keyboard and mouse as the input natives see them. capture() is called
+// on the window thread after every frame has read its events; poll() on
+// the thread that runs the ticks, before a batch of them runs. With a
+// render thread those are different threads, so a source backed by the
+// window must hand the state over between the two.
+class InputSource
+{
+public:
+    virtual ~InputSource() {}
+    virtual void capture() {}
+    virtual void poll() {}
+    virtual bool key_down(int key) { return false; }
+    virtual bool key_pressed(int key) { return false; }
+    virtual bool key_released(int key) { return false; }
+    virtual bool mouse_down(int button) { return false; }
+    virtual bool mouse_pressed(int button) { return false; }
+    virtual bool mouse_released(int button) { return false; }
+    virtual int mouse_x() { return 0; }
+    virtual int mouse_y() { return 0; }
+};
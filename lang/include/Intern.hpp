@@ -0,0 +1,29 @@
+#pragma once
+
+#include "Config.hpp"
+
+class ObjString;
+
+// Weak set of interned strings, open addressing on the hash cached in each
+// ObjString. The table never keeps a string alive: the collector takes a
+// string out right before it frees it.
+class InternTable
+{
+    ObjString** entries;
+    u32 capacity;
+    u32 used;   // live entries plus tombstones
+    u32 live;
+
+    bool grow();
+
+public:
+    InternTable();
+    ~InternTable();
+    InternTable(const InternTable&) = delete;
+    InternTable& operator=(const InternTable&) = delete;
+
+    ObjString* find(const char* text, size_t length, u32 hash) const;
+    bool insert(ObjString* string);
+    void remove(ObjString* string);
+    u32 size() const { return live; }
+};
@@ -20,7 +20,6 @@ private:
     int line;
     bool panicMode;
 
-    UnorderedMap<String,TokenType> keywords;
  
     Vector<String> variables;
 
@@ -53,7 +52,8 @@ private:
 
     void skipWhitespace();
 
-    Token addToken(TokenType type, String literal="");
+    Token addToken(TokenType type);
+    static TokenType keyword(const char* text, u32 length);
 
     void Error(String message);
 
@@ -68,7 +68,6 @@ private:
 public:
     Lexer();
     virtual ~Lexer();
-    void initialize();
     bool Load(String input);
     bool LoadFromFile(const String &fileName);
     Token scanToken();
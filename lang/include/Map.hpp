@@ -52,6 +52,13 @@ public:
 
     // Iteration support
     Vector<KeyValuePair> get_all_pairs() const;
+    template <typename Fn> void for_each(Fn fn) const
+    {
+        for (size_t i = 0; i < cap; i++)
+        {
+            if (buckets[i].is_occupied) fn(buckets[i].key, buckets[i].value);
+        }
+    }
 
 private:
     KeyValuePair* buckets;
@@ -432,6 +439,15 @@ size_t UnorderedMap<Key, Value, KeyAlloc, ValueAlloc>::hash_function(const Key&
         hash ^= hash >> 16;
         return hash;
     }
+    else if constexpr (std::is_pointer_v<Key>)
+    {
+        // Identity keys (interned strings): mix the address bits
+        size_t hash = reinterpret_cast<size_t>(key) >> 3;
+        hash ^= hash >> 16;
+        hash *= 0x85ebca6b;
+        hash ^= hash >> 13;
+        return hash;
+    }
     else if constexpr (std::is_same_v<Key, String>)
     {
         // FNV-1a otimizada para strings
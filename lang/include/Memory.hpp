@@ -0,0 +1,136 @@
+#pragma once
+
+#include "Config.hpp"
+#include <atomic>
+#include <cstdio>
+
+enum MemoryCategory : u8
+{
+    MEMORY_STRINGS,       // old (slab) strings; young ones only count as allocated
+    MEMORY_FUNCTIONS,     // functions, natives, processes and blueprints
+    MEMORY_PROCESSES,     // running instances
+    MEMORY_STACKS,        // value stacks and call frames
+    MEMORY_CHUNKS,        // bytecode and line tables
+    MEMORY_CONSTANTS,
+    MEMORY_GLOBALS,
+    MEMORY_CATEGORY_COUNT
+};
+
+const char* memoryCategoryName(u32 category);
+// false when name is not a category
+bool memoryCategoryFind(const char* name, MemoryCategory* category);
+
+// Live bytes and objects of what the interpreter allocates itself, kept at
+// the allocation sites. Relaxed atomics: workers grow stacks during
+// parallel ticks. Strings, constants and globals are not counted here, the
+// heap and the containers already know their size (see MemoryReport).
+class MemoryCounters
+{
+    struct Counter
+    {
+        std::atomic<s64> bytes{0};
+        std::atomic<s64> objects{0};
+        std::atomic<u64> allocated{0};   // bytes ever allocated
+    };
+    Counter counters[MEMORY_CATEGORY_COUNT];
+
+public:
+    void allocate(MemoryCategory category, size_t bytes, s32 objects = 1)
+    {
+        Counter& counter = counters[category];
+        counter.bytes.fetch_add((s64)bytes, std::memory_order_relaxed);
+        counter.objects.fetch_add(objects, std::memory_order_relaxed);
+        counter.allocated.fetch_add(bytes, std::memory_order_relaxed);
+    }
+
+    void release(MemoryCategory category, size_t bytes, s32 objects = 1)
+    {
+        Counter& counter = counters[category];
+        counter.bytes.fetch_sub((s64)bytes, std::memory_order_relaxed);
+        counter.objects.fetch_sub(objects, std::memory_order_relaxed);
+    }
+
+    // A buffer that was realloc'ed or handed over; growth counts as allocated.
+    void resize(MemoryCategory category, size_t oldBytes, size_t newBytes)
+    {
+        Counter& counter = counters[category];
+        counter.bytes.fetch_add((s64)newBytes - (s64)oldBytes, std::memory_order_relaxed);
+        if (newBytes > oldBytes) counter.allocated.fetch_add(newBytes - oldBytes, std::memory_order_relaxed);
+    }
+
+    s64 bytes(MemoryCategory category) const { return counters[category].bytes.load(std::memory_order_relaxed); }
+    s64 objects(MemoryCategory category) const { return counters[category].objects.load(std::memory_order_relaxed); }
+    u64 allocated(MemoryCategory category) const { return counters[category].allocated.load(std::memory_order_relaxed); }
+};
+
+extern MemoryCounters Memory;
+
+// Snapshot filled by Interpreter::memory_report().
+struct MemoryReport
+{
+    // GC pause histogram: bucket i holds pauses up to pauseLimits[i]
+    // microseconds, the last one everything longer.
+    static const u32 PAUSE_BUCKETS = 11;
+    static const u32 pauseLimits[PAUSE_BUCKETS - 1];
+
+    struct Category
+    {
+        u64 bytes;
+        u64 objects;
+        u64 peak;         // most bytes seen at a tick boundary or report
+        u64 allocated;    // bytes ever allocated (0 where not tracked)
+    };
+
+    u64 tick;
+    Category categories[MEMORY_CATEGORY_COUNT];
+    u64 totalBytes;
+    u64 totalPeak;
+
+    u64 heapPages;        // slab pages backing the old strings
+    u64 heapPageBytes;
+    u64 internedStrings;
+
+    // Bytes allocated per tick, all categories with an allocation count
+    u64 tickAllocated;    // last tick
+    u64 tickAllocatedMax;
+    u64 tickAllocatedAverage;
+
+    u64 gcCycles;
+    u64 gcPauses;
+    u64 gcPauseTotal;     // microseconds
+    u64 gcPauseMax;
+    u64 gcPauseHistogram[PAUSE_BUCKETS];
+
+    // One line of JSON, no newline. Returns the length it needed, like
+    // snprintf; the text is cut short when that is not less than size.
+    int format(char* buffer, size_t size) const;
+    bool write(FILE* out) const;
+};
+
+// What a report cannot read off the live counters: peaks, the per-tick
+// allocation rate and the collector pauses. Owned by the interpreter.
+class MemoryHistory
+{
+    u64 peaks[MEMORY_CATEGORY_COUNT];
+    u64 totalPeak;
+    u64 lastAllocated;    // total allocated at the end of the previous tick
+    u64 ticks;
+    u64 tickAllocated;
+    u64 tickAllocatedMax;
+    u64 tickAllocatedSum;
+
+    u64 cycles;
+    u64 pauses;
+    u64 pauseTotal;
+    u64 pauseMax;
+    u64 histogram[MemoryReport::PAUSE_BUCKETS];
+
+public:
+    MemoryHistory();
+
+    void clear();
+    // Takes the live values of report and fills in the rest.
+    void update(MemoryReport* report);
+    void endTick(const MemoryReport& report);
+    void pause(u64 microseconds, bool cycleDone);
+};
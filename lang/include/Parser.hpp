@@ -4,11 +4,13 @@
 #include "Utils.hpp"
 #include "Lexer.hpp"
 #include "Raii.hpp"
+#include "Arena.hpp"
  
 
 class Parser;
 class Interpreter;
 class Process;
+class ProcessBlueprint;
 class ObjFunction;
 class Value;
 
@@ -65,13 +67,40 @@ struct  ParseRule
 } ;
 
 
- 
+// Jump offsets waiting for a patch, in arena nodes.
+struct JumpList
+{
+    int offset;
+    JumpList* next;
+};
+
+// Functions finished in this compile, waiting to be packed.
+struct FunctionList
+{
+    ObjFunction* function;
+    FunctionList* next;
+};
+
+// The innermost loop being compiled; lives on the C++ stack of the
+// statement that opened it.
+struct LoopContext
+{
+    int loopStart;
+    int scopeDepth;       // locals deeper than this belong to the body
+    JumpList* breakJumps;
+    LoopContext* enclosing;
+};
 
 
 class Parser 
 {
 private:
     Lexer *lexer;
+    Arena arena;          // compile-only data, released when compile() ends
+    bool exhausted;       // the arena hit its limit; parsing stops
+    LoopContext* loop;
+    FunctionList* finished;
+    u32 finishedCount;
     Token current;
     Token previous;
     bool had_error;
@@ -80,7 +109,7 @@ private:
    // UnorderedMap<TokenType, ParseRule> rules;
     Interpreter* vm;
     ParseRule rules[256];
-    Process* current_process;
+    ProcessBlueprint* current_blueprint;
     ObjFunction* current_function;
     bool call_return;
     void parsePrecedence(Precedence precedence);
@@ -155,7 +184,20 @@ private:
 
         void breakStatement();
         void continueStatement();
-        void patchBreakJumps();
+        void beginLoop(LoopContext* context, int loopStart);
+        void endLoop();
+        void popLoopLocals();
+
+        bool addJump(JumpList** list, int offset);
+        void patchJumps(JumpList* list);
+        const char* copyName();
+        bool openBlueprint(ProcessBlueprint* blueprint);
+        void closeBlueprints();
+        void outOfMemory();
+        void finishFunction(ObjFunction* function);
+        void packCode();
+
+        u32 measureStack(ObjFunction* function, u32 baseDepth);
 
 
         friend class Interpreter;   
@@ -169,4 +211,7 @@ public:
 
 
     bool compile();
+
+    void setMemoryLimit(size_t bytes) { arena.setLimit(bytes); }
+    size_t memoryPeak() const { return arena.bytesPeak(); }
 };
\ No newline at end of file
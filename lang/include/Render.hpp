@@ -0,0 +1,55 @@
+#pragma once
+
+#include "Config.hpp"
+#include <mutex>
+
+// What the renderer needs of one visible process: where it is after the
+// last tick and where it was before it, for interpolation.
+struct RenderSprite
+{
+    float x, y, angle;
+    float lastX, lastY, lastAngle;
+};
+
+// Render state of one simulation tick, copied out of the FieldStore so the
+// render thread never touches live process data.
+class RenderSnapshot
+{
+public:
+    RenderSprite* sprites;
+    u32 count;
+    u32 capacity;
+    u32 dead;        // processes cleaned up since the previous snapshot
+    u64 tick;        // Interpreter::current_frame when taken
+    u64 published;   // wall clock (microseconds) when published
+
+    RenderSnapshot();
+    ~RenderSnapshot();
+    RenderSnapshot(const RenderSnapshot&) = delete;
+    RenderSnapshot& operator=(const RenderSnapshot&) = delete;
+
+    bool reserve(u32 size);
+};
+
+// Hands snapshots from the simulation thread to the render thread. The
+// writer fills its back slot and publishes it; the reader always gets the
+// newest published one. A third slot lets either side swap without ever
+// waiting for the other to finish a frame.
+class RenderBuffer
+{
+    RenderSnapshot slots[3];
+    u32 back;    // being written by the simulation
+    u32 ready;   // last published, not yet picked up
+    u32 front;   // being drawn
+    bool fresh;  // ready holds a snapshot the reader has not seen
+    std::mutex mutex;
+
+public:
+    RenderBuffer();
+
+    RenderSnapshot* write() { return &slots[back]; }
+    void publish();
+    RenderSnapshot* read();
+
+    static u64 now();
+};
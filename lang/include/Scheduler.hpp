@@ -0,0 +1,120 @@
+#pragma once
+
+#include "Config.hpp"
+
+class Process;
+
+// Intrusive circular list node. Every Process embeds one; a list is a
+// sentinel node with a null owner, so unlink and splice never need to know
+// which list an element currently sits in.
+struct SchedLink
+{
+    SchedLink* next;
+    SchedLink* prev;
+    Process* owner;
+
+    SchedLink(): next(this), prev(this), owner(nullptr) {}
+    explicit SchedLink(Process* owner): next(this), prev(this), owner(owner) {}
+    SchedLink(const SchedLink&) = delete;
+    SchedLink& operator=(const SchedLink&) = delete;
+
+    bool empty() const { return next == this; }
+    bool linked() const { return next != this; }
+
+    void unlink()
+    {
+        prev->next = next;
+        next->prev = prev;
+        next = this;
+        prev = this;
+    }
+
+    void push_back(SchedLink* node)
+    {
+        node->prev = prev;
+        node->next = this;
+        prev->next = node;
+        prev = node;
+    }
+
+    Process* pop_front()
+    {
+        SchedLink* node = next;
+        if (node == this) return nullptr;
+        node->unlink();
+        return node->owner;
+    }
+
+    // Moves every node of other to the back of this list.
+    void splice_back(SchedLink* other)
+    {
+        if (other->empty()) return;
+        SchedLink* first = other->next;
+        SchedLink* last = other->prev;
+        first->prev = prev;
+        prev->next = first;
+        last->next = this;
+        prev = last;
+        other->next = other;
+        other->prev = other;
+    }
+};
+
+
+// Run queue bucketed by priority. Higher priorities run first and order is
+// FIFO within a bucket. A bitmap of non-empty buckets makes pop O(1); bits
+// may go stale when a process is unlinked from outside and are cleared
+// lazily on the next pop.
+class RunQueue
+{
+public:
+    static const s32 PRIORITY_MIN = -128;
+    static const s32 PRIORITY_MAX = 127;
+
+private:
+    static const u32 BUCKETS = PRIORITY_MAX - PRIORITY_MIN + 1;
+    static const u32 WORDS = BUCKETS / 64;
+
+    SchedLink buckets[BUCKETS];
+    u64 mask[WORDS];
+
+public:
+    RunQueue();
+
+    static u32 bucket(s32 priority);
+
+    void push(Process* process);
+    void splice(RunQueue* other);
+    void group();
+    Process* pop();
+    bool empty();
+};
+
+
+// Hierarchical timer wheel keyed on absolute wake-up time in microseconds.
+// Level 0 has 256 one-millisecond slots; each of the three upper levels has
+// 64 slots covering 64 times the span of the level below (~18 hours total).
+// Entries further out are parked in the last slot and re-cascaded.
+class TimerWheel
+{
+    static const u32 RESOLUTION = 1000; // microseconds per level-0 slot
+    static const u32 LEVEL0_BITS = 8;
+    static const u32 LEVEL_BITS = 6;
+    static const u32 UPPER_LEVELS = 3;
+    static const u32 LEVEL0_SIZE = 1 << LEVEL0_BITS;
+    static const u32 LEVEL_SIZE = 1 << LEVEL_BITS;
+
+    SchedLink level0[LEVEL0_SIZE];
+    SchedLink upper[UPPER_LEVELS][LEVEL_SIZE];
+    u64 current; // level-0 slot being expired
+
+    void expire(SchedLink* slot, u64 now, SchedLink* due);
+    void cascade(SchedLink* slot);
+
+public:
+    TimerWheel();
+
+    void insert(Process* process);
+    void advance(u64 now, SchedLink* due);
+    void reset(u64 now);
+};
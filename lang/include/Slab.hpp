@@ -0,0 +1,145 @@
+#pragma once
+
+#include "Config.hpp"
+
+// One 64 KB page of the old space, cut into slots of a single size class.
+// Which slots are in use and which are marked is kept in the bitmaps up
+// front, so marking never touches an object and sweeping a page is a scan
+// over 2 x 32 words. Pages are aligned to their size, which is how an
+// object finds its page. An object bigger than the largest class gets a
+// page (of one or more 64 KB units) to itself.
+struct SlabPage
+{
+    static const size_t SIZE = 64 * 1024;
+    static const u32 WORDS = 32;          // bitmap words, 2048 slots of 32 bytes
+
+    SlabPage* next;       // every page, newest first; the sweep order
+    SlabPage* prev;
+    SlabPage* nextFree;   // pages of this class with a free slot
+    SlabPage* prevFree;
+    u32 sizeClass;
+    u32 slotSize;
+    u32 slotCount;
+    u32 live;
+    u32 hint;             // no free slot in the words below this one
+    bool swept;           // already swept in the running cycle
+    bool listed;          // on its class's free list
+    u64 used[WORDS];
+    u64 marked[WORDS];
+
+    static size_t header() { return (sizeof(SlabPage) + 15) & ~(size_t)15; }
+    static SlabPage* of(const void* object)
+    {
+        return (SlabPage*)((uintptr_t)object & ~(uintptr_t)(SIZE - 1));
+    }
+
+    u8* slots() { return (u8*)this + header(); }
+    u32 indexOf(const void* object) { return (u32)(((const u8*)object - slots()) / slotSize); }
+};
+
+inline u32 lowestBit(u64 word)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return (u32)__builtin_ctzll(word);
+#else
+    u32 bit = 0;
+    while (!(word & 1)) { word >>= 1; bit++; }
+    return bit;
+#endif
+}
+
+class SlabHeap
+{
+public:
+    static const u32 CLASS_COUNT = 21;
+    static const u32 LARGE = CLASS_COUNT;   // sizeClass of a one-object page
+
+private:
+    static const u32 classSizes[CLASS_COUNT];
+
+    SlabPage* pages;
+    SlabPage* freePages[CLASS_COUNT];
+    SlabPage* sweepCursor;
+    bool sweeping;
+
+    u32 objects;
+    size_t bytes;         // slot bytes in use
+    u64 allocated;        // slot bytes ever handed out
+    u32 pageCount;
+    size_t pageBytes;
+
+    static u32 classOf(size_t size);
+    SlabPage* newPage(u32 sizeClass, size_t slotSize);
+    void freePage(SlabPage* page);
+    void list(SlabPage* page);
+    void unlist(SlabPage* page);
+    void finishPage(SlabPage* page, u32 freed);
+
+public:
+    SlabHeap();
+    ~SlabHeap();
+    SlabHeap(const SlabHeap&) = delete;
+    SlabHeap& operator=(const SlabHeap&) = delete;
+
+    // black: the slot starts out marked (the collector is marking). A slot
+    // taken during a sweep, on a page the sweep has yet to reach, is
+    // marked as well so the sweep leaves it alone.
+    void* allocate(size_t size, bool black);
+
+    // Sets the mark bit; false if it was already set.
+    static bool mark(const void* object)
+    {
+        SlabPage* page = SlabPage::of(object);
+        u32 index = page->indexOf(object);
+        u64 bit = 1ull << (index & 63);
+        if (page->marked[index >> 6] & bit) return false;
+        page->marked[index >> 6] |= bit;
+        return true;
+    }
+
+    static bool isMarked(const void* object)
+    {
+        SlabPage* page = SlabPage::of(object);
+        u32 index = page->indexOf(object);
+        return (page->marked[index >> 6] >> (index & 63)) & 1;
+    }
+
+    void beginSweep();
+
+    // Sweeps the next page: onFree(object) for every unmarked object in
+    // use, then its slot is free. Marks are cleared for the next cycle.
+    // Returns false once every page has been swept.
+    template <typename Fn> bool sweepPage(Fn onFree)
+    {
+        SlabPage* page = sweepCursor;
+        if (!page)
+        {
+            sweeping = false;
+            return false;
+        }
+        sweepCursor = page->next;
+
+        u32 freed = 0;
+        for (u32 w = 0; w < SlabPage::WORDS; w++)
+        {
+            u64 dead = page->used[w] & ~page->marked[w];
+            while (dead)
+            {
+                u32 bit = lowestBit(dead);
+                dead &= dead - 1;
+                onFree(page->slots() + (size_t)(w * 64 + bit) * page->slotSize);
+                freed++;
+            }
+            page->used[w] &= page->marked[w];
+            page->marked[w] = 0;
+        }
+        finishPage(page, freed);
+        return true;
+    }
+
+    u32 objectCount() const { return objects; }
+    size_t bytesInUse() const { return bytes; }
+    u64 bytesAllocated() const { return allocated; }
+    u32 pagesInUse() const { return pageCount; }
+    size_t pageBytesInUse() const { return pageBytes; }
+};
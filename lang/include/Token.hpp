@@ -185,27 +185,27 @@ inline String tknString(TokenType type)
 
 
 
+// A token is a view into the source the Lexer was loaded with, so it stays
+// valid until the next Load and copying one is free. The lexeme is not
+// NUL-terminated; for STRING it is the text between the quotes.
 struct Token
 {
     TokenType type;
-    String lexeme;
-    String literal;
+    const char* lexeme;
+    u32 length;
     int line;
+    double number = 0;   // value of a NUMBER token
 
-    static Token errorToken() {        return Token(TokenType::ERROR, "ERROR", "ERROR", 0);    }
+    static Token errorToken() {        return Token(TokenType::ERROR, "ERROR", 0);    }
 
-    Token(TokenType type, String lexeme, String literal, int line)
+    Token(TokenType type, const char* lexeme, u32 length, int line)
     {
         this->type = type;
         this->lexeme = lexeme;
-        this->literal = literal;
+        this->length = length;
         this->line = line;
     }
-     Token() : type(TokenType::UNKNOWN), lexeme(""), literal(""), line(0) {}
-     ~Token() 
-     {
-        
-     }
-
-
-};
\ No newline at end of file
+    Token(TokenType type, const char* message, int line)
+        : Token(type, message, (u32)strlen(message), line) {}
+    Token() : type(TokenType::UNKNOWN), lexeme(""), length(0), line(0) {}
+};
@@ -24,6 +24,16 @@ void FreeTextFile(char *text);
 const char *longToString(long value);
 const char *doubleToString(double value);
 
+#define NUMBER_BUFFER_SIZE 32
+// Writes a number the way scripts see it into buffer, NUL terminated:
+// whole numbers in full, anything else as the shortest text that reads
+// back to the same double. Returns the length.
+u32 formatNumber(double value, char* buffer);
+
+// Reads a decimal number (digits, optional fraction and exponent) from
+// the first length characters of text. False if they are not one.
+bool parseNumber(const char* text, size_t length, double* value);
+
 size_t string_hash(const char *str);
 
 static inline bool matchString(const char *str1, const char *str2, size_t bLen)
@@ -7,6 +7,18 @@
 #include "Chunk.hpp"
 #include "Vector.hpp"
 #include "Map.hpp"
+#include "Scheduler.hpp"
+#include "Fields.hpp"
+#include "Handles.hpp"
+#include "Workers.hpp"
+#include "Render.hpp"
+#include "Host.hpp"
+#include "Intern.hpp"
+#include "Slab.hpp"
+#include "Memory.hpp"
+#include <atomic>
+#include <mutex>
+#include <thread>
  
 
 
@@ -18,6 +30,7 @@ class ObjString;
 class ObjProcess;
 class Parser;
 class Process;
+class ProcessBlueprint;
 
 const int ID_X=0;
 const int ID_Y=1;
@@ -28,6 +41,7 @@ const int ID_ANGLE=2;
 Value INTEGER(int value);
 Value NUMBER(double value);
 Value STRING(const char* value);
+Value STRING(const char* value, size_t length);
 Value SHARED_STRING(const char* value);
 Value BOOLEAN(bool value);
 Value NIL();
@@ -70,7 +84,7 @@ enum class ValueType
 };
 
 
-enum class ObjType
+enum class ObjType : u8
 {
 
     UPVALUE,
@@ -90,6 +104,24 @@ enum ProcessStatus : u32
 };
 
 
+// Runtime diagnostics; each level includes the ones below it.
+enum TraceLevel : u32
+{
+    TRACE_NONE = 0,
+    TRACE_SPAWN = 1, // process spawn/finish
+    TRACE_CODE = 2,  // disassemble each spawned process
+    TRACE_STACK = 3  // dump the stack before every instruction
+};
+
+
+// When processes spawned during a tick join the run list.
+enum SpawnPolicy : u32
+{
+    SPAWN_NEXT_TICK = 0, // admitted at the start of the next tick
+    SPAWN_SAME_TICK = 1  // admitted right away and run in the tick that created them
+};
+
+
 enum OpCode : u32
 {
     OP_CONSTANT,
@@ -128,6 +160,8 @@ enum OpCode : u32
 
     OP_GET_LOCAL,
     OP_SET_LOCAL,
+    OP_GET_FIELD,
+    OP_SET_FIELD,
     OP_DEFINE_LOCAL,
     OP_GET_GLOBAL,
     OP_DEFINE_GLOBAL,
@@ -140,7 +174,9 @@ enum OpCode : u32
 
     OP_NOW,
     OP_BREAK,
-    OP_CONTINUE
+    OP_CONTINUE,
+
+    OP_CONCAT,   // n: a chain of n '+' operands, folded left in one go
 
 
     // Process-specific opcodes
@@ -156,58 +192,71 @@ enum OpCode : u32
 
 class GarbageCollector;
 
+// Common header of collected objects. There is no vtable: the collector
+// frees an object by its type. Old objects live in SlabHeap slots, which
+// also hold their mark bits.
 class GCObject {
 public:
+    GCObject* forward; // young objects only: the promoted copy, once made
     ObjType type;
-    bool isMarked;
-    GCObject* next;
-    GCObject* prev;
+    bool isYoung;      // lives in the nursery
 
     GCObject(ObjType type)
-        : type(type), isMarked(false), next(nullptr), prev(nullptr)
+        : forward(nullptr), type(type), isYoung(false)
     {}
-    virtual ~GCObject() {}
-    virtual void trace(GarbageCollector* gc) {}
 };
 
 
+// One block: header followed by the characters, NUL terminated. Built in
+// place with create() on memory of sizeFor(length) bytes from the
+// collector's heap or nursery, never with new.
 class ObjString: public GCObject  
 {
 public:
-    char* data;
     int length;
-    ObjString();
-    ObjString(const char* str);
-    ObjString(const char* str,size_t length);
-    ObjString(int value);
-    ObjString(double value);
+    u32 hash;        // not computed for young strings, see promote()
+    bool isInterned; // in the collector's intern table, compare by pointer
+    char data[1];    // length + 1 bytes
 
+    static size_t sizeFor(size_t length) { return sizeof(ObjString) + length; }
+    static ObjString* create(void* memory, const char* text, size_t length, u32 hash);
+
+    // FNV-1a over the bytes.
+    static u32 hashOf(const char* text, size_t length)
+    {
+        u32 h = 2166136261u;
+        for (size_t i = 0; i < length; i++)
+        {
+            h ^= (u8)text[i];
+            h *= 16777619u;
+        }
+        return h;
+    }
 
      bool equals(const char* str) const 
      {
-        if (!data || !str) return false;
+        if (!str) return false;
         return strcmp(data, str) == 0;
     }
     
     bool equals(const ObjString* other) const 
     {
-        if (!other || !data || !other->data) return false;
+        if (this == other) return true;
+        if (!other) return false;
+        if (isInterned && other->isInterned) return false;
         if (length != other->length) return false;
-        return strcmp(data, other->data) == 0;
+        if (!isYoung && !other->isYoung && hash != other->hash) return false;
+        return memcmp(data, other->data, length) == 0;
     }
 
-    ~ObjString();
-};
-
-
-struct LoopContext 
-{
-    int loopStart;
-    ValueArray<int> breakJumps;
+private:
+    ObjString() : GCObject(ObjType::STRING) {}
 };
 
 
 typedef Value (*NativeFn)(int argCount, Value* args);
+// Natives that act on the process calling them (priority, signals, ...).
+typedef Value (*ProcessNativeFn)(Process* process, int argCount, Value* args);
 
 struct NativeReg 
 {
@@ -219,7 +268,11 @@ class ObjNative
 {
 public:
     NativeFn function;
-    ObjNative(NativeFn function):   function(function) {}
+    ProcessNativeFn processFunction;
+    bool threadSafe; // may run on a worker thread in parallel ticks
+    ObjNative(NativeFn function, bool threadSafe = false):   function(function), processFunction(nullptr), threadSafe(threadSafe) { Memory.allocate(MEMORY_FUNCTIONS, sizeof(ObjNative)); }
+    ObjNative(ProcessNativeFn function, bool threadSafe = false):   function(nullptr), processFunction(function), threadSafe(threadSafe) { Memory.allocate(MEMORY_FUNCTIONS, sizeof(ObjNative)); }
+    ~ObjNative() { Memory.release(MEMORY_FUNCTIONS, sizeof(ObjNative)); }
 };
 
 class ObjFunction  
@@ -227,12 +280,13 @@ class ObjFunction
  
 public:
     u8 arity;
+    u32 maxStack; // deepest stack the body reaches, measured after compile
     Chunk chunk;
     char name[32];
-    Vector<LoopContext> loopStack;
     ObjFunction();
     ObjFunction(const String& n);
     ObjFunction(const char* n);
+    ~ObjFunction();
 
 };
 
@@ -243,11 +297,12 @@ class ObjProcess
 public:
   
     char name[16];
-    Process* process;
+    ProcessBlueprint* blueprint;
     ObjFunction* function;
     ObjProcess();
     ObjProcess(const String& n);
     ObjProcess(const char* n);
+    ~ObjProcess();
 };
 
 
@@ -293,49 +348,111 @@ struct Value
 
 
 
+// Collector state. A cycle marks from the roots a slice at a time, then
+// sweeps the heap pages a slice at a time, then goes idle until enough
+// new objects have been allocated.
+enum GCPhase : u8
+{
+    GC_IDLE,
+    GC_MARK,
+    GC_SWEEP
+};
+
 class GarbageCollector {
 private:
-    GCObject* head;
     GCObject*** roots;
     int rootCount;
     int rootCapacity;
 
-    Vector<ObjString*> stringPool;  
-    UnorderedMap<String, ObjString*> stringMap;
-  
+    InternTable strings;
+    std::mutex lock; // objects can be created from worker threads
+
+    GCPhase phase;
+    SlabHeap heap;
+    u32 threshold;         // object count that starts the next cycle
+
+    // Nursery: strings made while a tick runs are bump-allocated here and
+    // the whole block is dropped when the tick ends. Workers allocate too,
+    // hence the atomic top.
+    u8* nursery;
+    std::atomic<size_t> nurseryTop;
+    u64 youngBytes;        // nursery bytes used by the ticks so far
+    bool nurseryOpen;
+    bool internRuntime;    // look up strings made during ticks as well
   
 
 public:
+    static const u32 MIN_THRESHOLD = 1024;
+    static const size_t NURSERY_SIZE = 1024 * 1024;
+
     GarbageCollector();
     ~GarbageCollector();
-    void addObject(GCObject* obj);
-    void removeObject(GCObject* obj);
-    template <typename T, typename... Args> T* allocate(Args&&... args)
-    {
-        T* obj = new T(args...);
-        addObject(obj);
-        return obj;
-    }
 
     void addRoot(GCObject** root);
     void collect();
-    int countObjects();
+    int countObjects() const { return (int)heap.objectCount(); }
 
+    // Strings for the VM. Outside ticks they are interned; during a tick
+    // they are young (see below), or the interned copy when one exists and
+    // runtime interning is on.
     ObjString* newString(const String& str);
     ObjString* newString(const char* str);
+    ObjString* newString(const char* text, size_t length);
+
+    // The single old copy of text, created on first use.
+    ObjString* intern(const char* text, size_t length);
+    ObjString* intern(const char* text, size_t length, u32 hash);
+    ObjString* findInterned(const char* text, size_t length);
+    void setRuntimeInterning(bool enabled) { internRuntime = enabled; }
+    u32 internedCount() const { return strings.size(); }
+
+    // For the memory report: old strings live in the heap, young ones only
+    // add to the bytes allocated.
+    const SlabHeap& getHeap() const { return heap; }
+    u64 bytesAllocated() const { return heap.bytesAllocated() + youngBytes; }
+
+    // Young strings. Anything that keeps one past the current tick must
+    // store promote()'s result instead.
+    ObjString* newYoungString(const char* text, size_t length);
+    ObjString* promote(ObjString* string);
+    void promote(Value* value)
+    {
+        if (value->type == ValueType::STRING && value->string->isYoung) value->string = promote(value->string);
+    }
+    void openNursery();
+    void closeNursery();
+
+    // Incremental cycle, driven by Interpreter::collect_step.
+    GCPhase getPhase() const { return phase; }
+    bool shouldStart() const { return phase == GC_IDLE && heap.objectCount() >= threshold; }
+    void beginMark();
+    void beginSweep();
+    bool sweep(u64 deadline);
+
+    // Write barrier: anything stored where the marker may already have
+    // looked is marked on the spot.
+    void shade(const Value& value)
+    {
+        if (phase == GC_MARK && value.type == ValueType::STRING) markObject(value.string);
+    }
 
 
 private:
     void markObject(GCObject* obj);
+    void release(GCObject* obj);
+    ObjString* lookup(const char* text, size_t length, u32 hash);
 
 public:
     void mark(GCObject* obj);
+    void mark(const Value& value);
 };
 
 
+// A local while its scope compiles. The name points into the source (or
+// the compiler's arena), which outlives it.
 struct Local
 {
-    char name[32]{ '\0' };
+    const char* name;
     u32 len;
     int depth;
     bool isArg;
@@ -352,74 +469,130 @@ public:
 
 
 
-class Process 
+// Compile-time description of a process type. The Parser fills the locals
+// table while compiling; runtime Process instances only keep a pointer.
+class ProcessBlueprint
 {
-private:
-    static u32 nextPID;
-    static const s32 FRAMES_MAX = 16;
-    static const s32 STACK_MAX = 256;//FRAMES_MAX * 256;
-    static const s32 UINT8_COUNT = 128; 
+public:
+    static const s32 UINT8_COUNT = 128;
 
+    char name[16];
+    Local* locals;          // UINT8_COUNT slots from the Parser's arena, while compiling
+    int localCount;
+    s32 scopeDepth;
+    u8 fieldCount; // built-in fields (x, y, angle), kept in the FieldStore
+    double fields[FieldStore::FIELD_COUNT]; // spawn defaults for the fields
+    u32 maxStack;
+    ObjFunction* function;
+    SchedLink group;              // scratch list for RunQueue::group()
+    ProcessBlueprint* groupNext;
+    SchedLink instances;          // live instances, in spawn order
+    u32 instanceCount;
 
+    ProcessBlueprint(const char* name);
+    ~ProcessBlueprint();
 
+    int addLocal(const char* name,size_t len,bool isArg);
+    int resolveLocal(const char* name,size_t len);
+    int addLocal(const char* name);
+    void markInitialized();
+    void defineFields();
+    int resolveField(const char* name, size_t len) const;
+
+    u8 arity() const;
+};
 
-    Local locals[UINT8_COUNT];
-    int localCount;
-    int defineLocals;
-    s32 scopeDepth;
 
-    CallFrame frames[FRAMES_MAX];
+class Process 
+{
+private:
+    static u32 nextSerial;
+    static const s32 FRAMES_MAX = 16;
+    static const s32 CALL_COST = 8;  // budget charged per script call
+    static const s32 STACK_MAX = 256;
+
+    CallFrame* frames;
     CallFrame* currentFrame;
     int frameCount;
+    int frameCapacity;
+    int defineLocals;
 
-    Value stack[STACK_MAX];
+    Value* stack;
     Value* stackTop;
+    u32 stackCapacity;
   
 
-    void runtimeError(const String& message);
     void disassembleCode(Chunk* chunk, const char* name);
     u32 disassembleInstruction(Chunk* chunk, u32 offset);
     u32 constantInstruction(Chunk* chunk, const char* name, u32 offset);
     u32 byteInstruction(Chunk* chunk, const char* name, u32 offset);
     u32 jumpInstruction(Chunk* chunk, const char* name, u32 sign, u32 offset);
     u32 simpleInstruction(Chunk* chunk, const char* name, u32 offset);
-    void markInitialized();
 
+    bool growStack(u32 needed);
+    bool growFrames();
+    bool concatenate(u32 count);
 
-    void init_locals();
+    void start(const Value* args, int argCount);
 
     friend class GarbageCollector;
     friend class Interpreter;
     friend class Parser;
+    friend class TimerWheel;
+    friend class RunQueue;
     Interpreter* interpreter;
 
-    double frame_timer;
-    double frame_interval;
+    SchedLink sched;  // run queue, timer wheel slot or status list
+    u64 wake_time;    // interpreter clock (microseconds) of the next run
+    bool queued;      // sched is in a RunQueue bucket
+    s64 budget;       // instruction budget left this tick
+    bool preempted;   // last run() stopped on an exhausted budget
+    bool deferred;    // last run() stopped on an op that must run serially
+
+    // Global writes made during a parallel tick, applied at its end.
+    struct PendingGlobal
+    {
+        ObjString* name;
+        Value value;
+    };
+    Vector<PendingGlobal> pendingGlobals;
+    void bufferGlobal(ObjString* name, const Value& value);
+    bool findPendingGlobal(ObjString* name, Value* value) const;
+    void setStatus(ProcessStatus status);
+    void leaveBlueprint();
+    void adopt(Process* child);
+    void leaveFamily();
     double frame_speed_multiplier;
 
 public:
  
     char name[16];
-    u32 id;
+    u32 id;           // handle, see HandleTable
+    u32 serial;       // creation order
     s32 priority;
     ProcessStatus status;
     s32 frame_percent;
+    u32 preemptions;  // ticks cut short by the instruction budget
     ProcessStatus saved_status;
  
+    ProcessBlueprint* blueprint;
     ObjFunction* function;
     bool root;
+    u32 field;        // row in Interpreter::fields, FieldStore::NO_ROW if none
+    SchedLink instanceLink; // in blueprint->instances while alive
+    Process* father;        // spawning process, nullptr once it dies
+    SchedLink children;     // live children, oldest first
+    SchedLink siblingLink;  // in father->children
 
 
     Process* next;
     Process* prev;
 
 
-    int addLocal(const char* name,size_t len,bool isArg);
-    int resolveLocal(const char* name,size_t len);
-    int addLocal(const char* name);
-
     void printStack() const;
     void resetStack();
+    // Reports and unwinds; natives may call it, the process then stops.
+    void runtimeError(const String& message);
     void push(Value value);
     Value pop();
     Value top();
@@ -431,14 +604,13 @@ public:
 
     bool call(ObjFunction* function, int argCount);
 
-    void writeChunk(u8 instruction, int line);
-
-    Process(Interpreter* interpreter,bool isRoot);
+    Process(Interpreter* interpreter, ProcessBlueprint* blueprint, bool isRoot);
     ~Process();
 
     bool run();
     void setFrameSpeed(double speed_multiplier);
     void pauseForSeconds(double seconds);
+    Interpreter* getInterpreter() const { return interpreter; }
 
     void disassemble();
     bool isEmpty();
@@ -450,7 +622,9 @@ class Interpreter {
     Process* first_instance;
     Process* last_instance;
  
+ 
     Process* main_process; 
+    ProcessBlueprint* main_blueprint;
  
     u32 next_process_id;
     u32 current_frame;
@@ -460,11 +634,66 @@ class Interpreter {
  
 
     bool panicMode;
+    u32 trace_level;
 
     //blueprints
 
-    ValueArray<Process*> processes;
-    ValueArray<Process*> queu_processes;
+    ValueArray<ProcessBlueprint*> blueprints;
+    Process* queue_first; // spawned this tick, not yet in the run list
+    Process* queue_last;
+    SpawnPolicy spawn_policy;
+    bool group_by_blueprint;
+
+    // Scheduling: each live process sits in exactly one of these.
+    u64 clock;                 // microseconds of simulated time
+    u64 tick_length;           // microseconds per simulation tick
+    u32 max_catchup;           // ticks run per frame at most
+    u64 accumulator;           // real time not yet simulated
+    u32 instruction_budget;    // per process per tick, 0 = unlimited
+    u64 preemptions;
+    WorkerPool workers;
+    bool parallel_phase;       // processes are running on worker threads
+    Vector<Process*> batch;    // processes of the parallel tick, in run order
+    bool threaded_render;      // run() simulates on its own thread
+    bool interpolate;          // draw between the last two ticks
+    RenderBuffer frames;       // simulation -> render thread handoff
+    std::thread simulation;
+    std::atomic<bool> simulation_stop;
+    std::atomic<bool> simulation_running;
+    u32 gc_budget;             // microseconds of collection per tick, 0 = off
+    Process* gc_cursor;        // next process stack to mark
+    MemoryHistory memory_history;
+    u32 memory_dump_ticks;     // 0 = no periodic dump
+    FILE* memory_dump_file;
+    void collect_step();
+    void collect_slice();
+    void mark_roots();
+    void mark_process(Process* process);
+    SystemClock system_clock;
+    InputSource no_input;
+    Clock* time_source;        // drives the run loops
+    InputSource* input;        // read by the input natives
+    void prepare(Process* process);
+    void step(Process* process);
+    void finish(Process* process);
+    void run_batch();
+    static void run_batch_task(void* context, u32 index);
+    void simulate();
+    void publish_frame(u32 dead_count);
+    u32 run_threaded();
+    Process* running_process;
+    RunQueue spawned;          // mirrors queue_first..queue_last
+    RunQueue runnable;         // due this tick, by priority
+    TimerWheel timers;         // running, waiting for frame/pause to elapse
+    SchedLink sleeping;
+    SchedLink frozen;
+    SchedLink waiting;
+    SchedLink paused;
+    SchedLink dead;
+
+    void schedule(Process* process);
+    FieldStore fields;
+    HandleTable handles;
     ValueArray<ObjProcess*> raw_processes;
   
  
@@ -474,7 +703,7 @@ class Interpreter {
 
 
     Parser* parser;
-    UnorderedMap<String, Value> globals;
+    UnorderedMap<ObjString*, Value> globals; // keyed by interned name
     ValueArray<Value> constants;
     friend class Parser;
     friend class Process;
@@ -488,12 +717,20 @@ public:
 
 
     void clear();
-    Process* add_process(const char* name, bool root, int32_t priority = 0);
-    Process* create_process(const char* name);
+    Process* add_process(ProcessBlueprint* blueprint, bool root, int32_t priority = 0);
+    ProcessBlueprint* create_blueprint(const char* name);
 
     bool call_process(Process* process, int32_t priority = 0);
 
-    Process* queue_process(const char* name, int32_t priority);
+    Process* queue_process(ProcessBlueprint* blueprint, int32_t priority);
+    void admit_queued();
+    void set_spawn_policy(SpawnPolicy policy);
+    void set_group_scheduling(bool enabled);
+    void set_status(Process* process, ProcessStatus status);
+    void set_priority(Process* process, s32 priority);
+    u32 signal_type(ProcessBlueprint* blueprint, ProcessStatus status);
+    u32 signal_tree(Process* process, ProcessStatus status);
+    ProcessBlueprint* find_blueprint(const char* name);
 
     void Error(const char *format, ...);
     void Warning(const char *format, ...);
@@ -510,22 +747,61 @@ public:
     void remove_process_from_list(Process* process);
     Process* find_process(const char* name);
     Process* find_process(u32 pid);
+    bool process_exists(u32 pid);
     void request_exit(s32 value = 0);
+    void set_trace_level(u32 level);
     u32 run();
+    u32 tick();
+    u32 run_ticks(u32 count);
+    u32 run_headless(u32 ticks);
+    void set_clock(Clock* source);
+    void set_input(InputSource* source);
+    InputSource* get_input() const { return input; }
+    void set_tick_rate(u32 hz);
+    void set_max_catchup(u32 ticks);
+    void set_instruction_budget(u32 budget);
+    // Runs each tick's processes on count threads. While they run, every
+    // process reads the globals as they were when its batch started; its
+    // writes are merged after the batch, in run order, so the last writer
+    // wins. Read-modify-write from many processes (hits = hits + 1) thus
+    // adds once per tick, not once per process as in the serial tick.
+    void set_worker_threads(u32 count);
+    void set_gc_budget(u32 microseconds);
+    void collect_garbage();
+    // Memory by category, with peaks, bytes allocated per tick and the
+    // collector's pauses. Call between ticks.
+    void memory_report(MemoryReport* report);
+    bool dump_memory(FILE* out);
+    // Writes a report line to out every `ticks` ticks; 0 stops it.
+    void set_memory_dump(u32 ticks, FILE* out);
+    void set_render_thread(bool enabled);
+    void set_interpolation(bool enabled);
+    u64 get_preemptions() const { return preemptions; }
 
     bool define(const char* name, Value value);
+    bool define(ObjString* name, Value value);
     bool contains(const char* name );
     Value get(const char* name);
+    Value* find_global(ObjString* name);
+    void set_runtime_interning(bool enabled);
     u32 addConstant(Value value);
 
     bool compile(const char* source);
+    // Caps the compiler's scratch memory; a compile that needs more fails
+    // with an error. 0 (the default) means no cap.
+    void set_compiler_memory_limit(size_t bytes);
     bool compile_file(const char* path);
 
     void runtimeError(const String& message);
 
     void disassemble();
 
-    void defineNative(const char* name, NativeFn function);
+    void defineNative(const char* name, NativeFn function, bool threadSafe = false);
+    void defineProcessNative(const char* name, ProcessNativeFn function, bool threadSafe = false);
+    void defineProcessNatives();
+    void defineStandardNatives();
+    void defineInputNatives();
+    void defineMemoryNatives();
     void defineNatives(const NativeReg* natives) ;
 
 
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "Config.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+// Fixed set of threads that run one batch of indexed tasks at a time.
+// Every worker starts on its own contiguous slice of the batch and, once
+// that is used up, steals chunks from the other slices. The thread that
+// calls run() takes part as worker 0.
+class WorkerPool
+{
+public:
+    typedef void (*TaskFn)(void* context, u32 index);
+
+    static const u32 MAX_WORKERS = 64;
+
+    WorkerPool();
+    ~WorkerPool();
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    void start(u32 workers);
+    void stop();
+    u32 size() const { return workerCount; }
+
+    void run(u32 count, TaskFn task, void* context);
+
+private:
+    static const u32 CHUNK = 8;
+
+    struct alignas(64) Slice
+    {
+        std::atomic<u32> next;
+        u32 end;
+    };
+
+    Slice slices[MAX_WORKERS];
+    std::thread* threads;
+    u32 workerCount;
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    u64 batch;
+    u32 pending;
+    bool quit;
+
+    TaskFn task;
+    void* context;
+
+    void loop(u32 worker);
+    void work(u32 worker);
+};
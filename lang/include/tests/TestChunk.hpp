@@ -84,7 +84,7 @@ public:
         // Verify data integrity
         for (u32 i = 0; i < original.count; ++i) {
             assert(copy.code[i] == original.code[i]);
-            assert(copy.lines[i] == original.lines[i]);
+            assert(copy.lineAt(i) == original.lineAt(i));
         }
         
         std::cout << "Copy constructor: PASSED" << std::endl;
@@ -113,7 +113,7 @@ public:
         
         for (u32 i = 0; i < source.count; ++i) {
             assert(target.code[i] == source.code[i]);
-            assert(target.lines[i] == source.lines[i]);
+            assert(target.lineAt(i) == source.lineAt(i));
         }
         
         // Test clone with nullptr
@@ -132,7 +132,7 @@ public:
         chunk.write(0x42, 100);
         assert(chunk.count == 1);
         assert(chunk[0] == 0x42);
-        assert(chunk.lines[0] == 100);
+        assert(chunk.lineAt(0) == 100);
 
 
         u8 instructions[] = {0x10, 0x20, 0x30, 0x40};
@@ -149,7 +149,7 @@ public:
         assert(chunk[0] == 0x42);
         for (size_t i = 0; i < 4; ++i) {
             assert(chunk[i + 1] == instructions[i]);
-            assert(chunk.lines[i + 1] == lines[i]);
+            assert(chunk.lineAt(i + 1) == lines[i]);
         }
         
   
@@ -178,7 +178,7 @@ public:
         // Verify all data is preserved
         for (int i = 0; i < 10; ++i) {
             assert(chunk[i] == static_cast<u8>(i));
-            assert(chunk.lines[i] == i * 10);
+            assert(chunk.lineAt(i) == i * 10);
         }
         
         std::cout << "Capacity growth: PASSED" << std::endl;
@@ -204,7 +204,7 @@ public:
         // Verify data integrity
         for (int i = 0; i < 5; ++i) {
             assert(chunk[i] == static_cast<u8>(i));
-            assert(chunk.lines[i] == i);
+            assert(chunk.lineAt(i) == i);
         }
         
         // Reserve smaller capacity (should not shrink)
@@ -248,7 +248,7 @@ public:
         for (int i = 0; i < iterations; ++i) 
         {
             assert(chunk[i] == expected_instructions[i]);
-            assert(chunk.lines[i] == expected_lines[i]);
+            assert(chunk.lineAt(i) == expected_lines[i]);
         }
         
         std::cout << "Stress write: PASSED" << std::endl;
@@ -276,8 +276,8 @@ public:
         
         assert(boundary_chunk[0] == 0x00);
         assert(boundary_chunk[1] == 0xFF);
-        assert(boundary_chunk.lines[0] == INT_MIN);
-        assert(boundary_chunk.lines[1] == INT_MAX);
+        assert(boundary_chunk.lineAt(0) == INT_MIN);
+        assert(boundary_chunk.lineAt(1) == INT_MAX);
         
         std::cout << "Edge cases: PASSED" << std::endl;
     }
@@ -304,13 +304,46 @@ public:
             
             for (int j = 0; j <= i; ++j) {
                 assert((*chunks[i])[j] == static_cast<u8>(i + j));
-                assert(chunks[i]->lines[j] == i * 1000 + j);
+                assert(chunks[i]->lineAt(j) == i * 1000 + j);
             }
         }
         
         std::cout << "Memory integrity: PASSED" << std::endl;
     }
     
+    void testPack() {
+        std::cout << "Testing pack..." << std::endl;
+
+        Chunk first(4);
+        Chunk second(4);
+        for (int i = 0; i < 300; ++i) {
+            first.write(static_cast<u8>(i), i / 7 + 1);
+            second.write(static_cast<u8>(255 - i), 1000 - i);
+        }
+
+        Chunk* chunks[] = { &first, &second };
+        CodeSegment* segment = CodeSegment::pack(chunks, 2);
+        assert(segment != nullptr);
+        assert(first.segment == segment && second.segment == segment);
+        assert(second.code == first.code + first.count); // back to back
+
+        for (int i = 0; i < 300; ++i) {
+            assert(first[i] == static_cast<u8>(i));
+            assert(first.lineAt(i) == i / 7 + 1);
+            assert(second.lineAt(i) == 1000 - i);
+        }
+
+        // Writing to a packed chunk copies it back out first
+        second.write(0x42, 2000);
+        assert(second.segment == nullptr);
+        assert(second.count == 301);
+        assert(second[0] == 255 && second[300] == 0x42);
+        assert(second.lineAt(299) == 701 && second.lineAt(300) == 2000);
+        assert(segment->users == 1);
+
+        std::cout << "Pack: PASSED" << std::endl;
+    }
+
     void performanceTest() {
         std::cout << "\n=== PERFORMANCE TESTING ===" << std::endl;
         
@@ -362,6 +395,7 @@ public:
         testStressWrite();
         testEdgeCases();
         testMemoryIntegrity();
+        testPack();
         performanceTest();
         
         auto end = std::chrono::high_resolution_clock::now();
@@ -0,0 +1,138 @@
+#include "Arena.hpp"
+#include "Utils.hpp"
+
+
+Arena::Arena()
+{
+    blocks = nullptr;
+    used = 0;
+    peak = 0;
+    reserved = 0;
+    limit = 0;
+}
+
+Arena::~Arena()
+{
+    while (blocks)
+    {
+        Block* next = blocks->next;
+        std::free(blocks);
+        blocks = next;
+    }
+}
+
+Arena::Block* Arena::newBlock(size_t size)
+{
+    Block* block = (Block*) std::malloc(Block::header() + size);
+    if (!block)
+    {
+        ERROR("Out of memory for a compiler block (%zu bytes)", size);
+        return nullptr;
+    }
+    block->size = size;
+    block->used = 0;
+    reserved += size;
+    return block;
+}
+
+void* Arena::allocate(size_t size, size_t align)
+{
+    if (limit && used + size > limit)
+    {
+        ERROR("Compiler memory limit reached (%zu bytes)", limit);
+        return nullptr;
+    }
+
+    Block* block = blocks;
+    size_t offset = 0;
+    if (block)
+    {
+        offset = (block->used + align - 1) & ~(align - 1);
+    }
+    if (!block || offset + size > block->size)
+    {
+        // A request bigger than a block gets a block of its own, linked
+        // behind the current one so the current one keeps filling.
+        bool large = size > BLOCK_SIZE / 4;
+        Block* fresh = newBlock(large && size > BLOCK_SIZE ? size : BLOCK_SIZE);
+        if (!fresh) return nullptr;
+        if (large && block)
+        {
+            fresh->next = block->next;
+            block->next = fresh;
+        }
+        else
+        {
+            fresh->next = blocks;
+            blocks = fresh;
+        }
+        block = fresh;
+        offset = 0;
+    }
+
+    block->used = offset + size;
+    used += size;
+    if (used > peak) peak = used;
+    return block->data() + offset;
+}
+
+char* Arena::copy(const char* text, size_t len)
+{
+    char* result = (char*) allocate(len + 1, 1);
+    if (!result) return nullptr;
+    memcpy(result, text, len);
+    result[len] = '\0';
+    return result;
+}
+
+Arena::Mark Arena::mark() const
+{
+    Mark mark;
+    mark.block = blocks;
+    mark.blockUsed = blocks ? blocks->used : 0;
+    mark.used = used;
+    return mark;
+}
+
+// Frees the blocks opened since the mark and resets the marked one. Large
+// blocks linked behind the marked block stay until release().
+void Arena::rewind(const Mark& mark)
+{
+    while (blocks && blocks != mark.block)
+    {
+        Block* next = blocks->next;
+        reserved -= blocks->size;
+        std::free(blocks);
+        blocks = next;
+    }
+    if (blocks) blocks->used = mark.blockUsed;
+    used = mark.used;
+}
+
+void Arena::release()
+{
+    if (!blocks) return;
+    Block* last = blocks;
+    while (last->next) last = last->next;
+
+    while (blocks != last)
+    {
+        Block* next = blocks->next;
+        reserved -= blocks->size;
+        std::free(blocks);
+        blocks = next;
+    }
+    // The oldest block is a full-size one unless the very first request
+    // was large; only a full-size block is worth keeping.
+    if (last->size != BLOCK_SIZE)
+    {
+        reserved -= last->size;
+        std::free(last);
+        blocks = nullptr;
+    }
+    else
+    {
+        last->used = 0;
+    }
+    used = 0;
+}
@@ -0,0 +1,123 @@
+#include "VM.hpp"
+#include "Utils.hpp"
+
+
+ProcessBlueprint::ProcessBlueprint(const char* name)
+{
+    size_t len = strlen(name);
+    if (len > sizeof(this->name) - 1) len = sizeof(this->name) - 1;
+    memcpy(this->name, name, len);
+    this->name[len] = '\0';
+    locals = nullptr;
+    localCount = 0;
+    scopeDepth = 0;
+    fieldCount = 0;
+    maxStack = 0;
+    function = new ObjFunction(this->name);
+    groupNext = nullptr;
+    instanceCount = 0;
+    Memory.allocate(MEMORY_FUNCTIONS, sizeof(ProcessBlueprint));
+}
+
+ProcessBlueprint::~ProcessBlueprint()
+{
+    delete function;
+    function = nullptr;
+    Memory.release(MEMORY_FUNCTIONS, sizeof(ProcessBlueprint));
+}
+
+u8 ProcessBlueprint::arity() const
+{
+    return function->arity;
+}
+
+int ProcessBlueprint::addLocal(const char* name) 
+{
+    if (!locals)
+    {
+        ERROR("Blueprint '%s' is not being compiled.", this->name);
+        return -1;
+    }
+    if (localCount >= UINT8_COUNT)
+    {
+        ERROR("Too many local variables in function.");
+        return -1;
+    }
+    
+    Local *local = &locals[localCount++];
+    
+    local->name = name;
+    local->len = strlen(name);
+    local->isArg = true;
+    local->depth = 0;
+    
+    return localCount - 1;
+}
+
+int ProcessBlueprint::addLocal(const char* name,size_t len, bool isArg) 
+{
+    if (!locals)
+    {
+        ERROR("Blueprint '%s' is not being compiled.", this->name);
+        return -1;
+    }
+    if (localCount >= UINT8_COUNT)
+    {
+        ERROR("Too many local variables in function.");
+        return -1;
+    }
+    
+    Local *local = &locals[localCount++];
+    
+    local->name = name;
+    local->len = len;
+    local->isArg = isArg;
+    local->depth = -1;
+    
+    return localCount - 1;
+}
+
+static bool identifiersEqual(const char* a,size_t aLen, const char* b, size_t bLen)
+{
+    if (aLen != bLen) return false;   
+    return memcmp(a, b, aLen) == 0;
+}
+
+int ProcessBlueprint::resolveLocal(const char* name,size_t len)
+{
+    for (int i = localCount - 1; i >= 0; i--) 
+    {
+        Local* local = &locals[i];
+        if (identifiersEqual(local->name, local->len, name, len)) 
+        {
+            if (local->depth == -1) 
+            {
+                ERROR("Can't read local variable in its own initializer.");
+                return -1;
+            }
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+void ProcessBlueprint::markInitialized() 
+{
+    if (scopeDepth == 0) return;
+    locals[localCount - 1].depth = scopeDepth;
+}
+
+void ProcessBlueprint::defineFields()
+{
+    fields[ID_X] = 30;
+    fields[ID_Y] = 2;
+    fields[ID_ANGLE] = 360;
+    fieldCount = FieldStore::FIELD_COUNT;
+}
+
+int ProcessBlueprint::resolveField(const char* name, size_t len) const
+{
+    if (fieldCount == 0) return -1;
+    return FieldStore::resolve(name, len);
+}
@@ -1,26 +1,49 @@
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOGDI
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
 #include "Chunk.hpp"
 #include "Utils.hpp"
+#include "Memory.hpp"
+
+static const u32 LINE_CAPACITY = 16;
 
 Chunk::Chunk(u32 capacity)
     :  m_capacity(capacity), count(0)
 {
     code  = (u8*)  std::malloc(capacity * sizeof(u8));
-    lines = (int*) std::malloc(capacity * sizeof(int));
-
- 
+    lines = (u8*)  std::malloc(LINE_CAPACITY);
+    lineCapacity = LINE_CAPACITY;
+    lineBytes = 0;
+    lastLine = 0;
+    lastOffset = 0;
+    segment = nullptr;
+    Memory.allocate(MEMORY_CHUNKS, ownedBytes());
 }
 
 Chunk::Chunk(Chunk *other)
 {
 
     code  = (u8*)  std::malloc(other->m_capacity * sizeof(u8));
-    lines = (int*) std::malloc(other->m_capacity * sizeof(int));
-    
+    lines = (u8*)  std::malloc(other->lineBytes > LINE_CAPACITY ? other->lineBytes : LINE_CAPACITY);
+
     m_capacity = other->m_capacity;
     count = other->count;
+    lineCapacity = other->lineBytes > LINE_CAPACITY ? other->lineBytes : LINE_CAPACITY;
+    lineBytes = other->lineBytes;
+    lastLine = other->lastLine;
+    lastOffset = other->lastOffset;
+    segment = nullptr;
+    Memory.allocate(MEMORY_CHUNKS, ownedBytes());
 
-    std::memcpy(code, other->code, other->m_capacity * sizeof(u8));
-    std::memcpy(lines, other->lines, other->m_capacity * sizeof(int));
+    std::memcpy(code, other->code, other->count * sizeof(u8));
+    std::memcpy(lines, other->lines, other->lineBytes);
 }
 
 
@@ -29,16 +52,29 @@ bool Chunk::clone(Chunk *other)
      if (!other)
         return false;
 
-    
-    std::free(other->code);
-    std::free(other->lines);
+    size_t before = other->ownedBytes();
+    if (other->segment)
+    {
+        other->segment->release();
+        other->segment = nullptr;
+    }
+    else
+    {
+        std::free(other->code);
+        std::free(other->lines);
+    }
+
 
-    
     other->m_capacity = m_capacity;
     other->count = count;
+    other->lineCapacity = lineBytes > LINE_CAPACITY ? lineBytes : LINE_CAPACITY;
+    other->lineBytes = lineBytes;
+    other->lastLine = lastLine;
+    other->lastOffset = lastOffset;
+    Memory.resize(MEMORY_CHUNKS, before, other->ownedBytes());
 
     other->code = (u8*) std::malloc(m_capacity * sizeof(u8));
-    other->lines = (int*) std::malloc(m_capacity * sizeof(int));
+    other->lines = (u8*) std::malloc(other->lineCapacity);
 
     if (!other->code || !other->lines)
     {
@@ -49,70 +85,169 @@ bool Chunk::clone(Chunk *other)
     }
 
     std::memcpy(other->code, code, count * sizeof(u8));
-    std::memcpy(other->lines, lines, count * sizeof(int));
+    std::memcpy(other->lines, lines, lineBytes);
 
     return true;
-    
+
 }
 
 
 Chunk::~Chunk()
 {
+    Memory.release(MEMORY_CHUNKS, ownedBytes());
+    if (segment)
+    {
+        segment->release();
+        return;
+    }
     std::free(code);
     std::free(lines);
 
   //  printf("destroy chunk  \n");
 }
 
+// A packed chunk is read-only; writing to it again (a second compile into
+// the same function) first copies it back out of its segment.
+bool Chunk::own()
+{
+    if (!segment) return true;
+
+    u32 capacity = m_capacity > count ? m_capacity : count + 1;
+    u32 lineSize = lineBytes > LINE_CAPACITY ? lineBytes : LINE_CAPACITY;
+    u8* newCode  = (u8*) std::malloc(capacity);
+    u8* newLines = (u8*) std::malloc(lineSize);
+    if (!newCode || !newLines)
+    {
+        std::free(newCode);
+        std::free(newLines);
+        ERROR("Out of memory for chunk");
+        return false;
+    }
+    std::memcpy(newCode, code, count);
+    std::memcpy(newLines, lines, lineBytes);
+
+    segment->release();
+    segment = nullptr;
+    code = newCode;
+    lines = newLines;
+    m_capacity = capacity;
+    lineCapacity = lineSize;
+    Memory.resize(MEMORY_CHUNKS, 0, ownedBytes());
+    return true;
+}
+
 void Chunk::reserve(u32 capacity)
 {
     if (capacity > m_capacity)
     {
-       
+        if (!own()) return;
 
         u8 *newCode  = (u8*) (std::realloc(code,  capacity * sizeof(u8)));
-        int *newLine = (int*)(std::realloc(lines, capacity * sizeof(int)));
 
-        if (!newCode || !newLine)
+        if (!newCode)
         {
-            std::free(newCode);
-            std::free(newLine);
-            DEBUG_BREAK_IF(newCode == nullptr || newLine == nullptr);
+            DEBUG_BREAK_IF(newCode == nullptr);
             return;
         }
 
 
 
         code = newCode;
-        lines = newLine;      
+        Memory.resize(MEMORY_CHUNKS, m_capacity, capacity);
         m_capacity = capacity;
     }
 }
 
+static u32 writeVarint(u8* out, u64 value)
+{
+    u32 length = 0;
+    while (value >= 0x80)
+    {
+        out[length++] = (u8)(value | 0x80);
+        value >>= 7;
+    }
+    out[length++] = (u8)value;
+    return length;
+}
+
+static u64 readVarint(const u8* in, u32* position)
+{
+    u64 value = 0;
+    u32 shift = 0;
+    u8 byte;
+    do
+    {
+        byte = in[(*position)++];
+        value |= (u64)(byte & 0x7F) << shift;
+        shift += 7;
+    } while (byte & 0x80);
+    return value;
+}
+
+void Chunk::addLine(u32 offset, int line)
+{
+    // Two varints: at most 5 bytes of offset and 10 of line delta
+    if (lineBytes + 15 > lineCapacity)
+    {
+        u32 newCapacity = lineCapacity * 2;
+        u8* newLines = (u8*) std::realloc(lines, newCapacity);
+        if (!newLines)
+        {
+            DEBUG_BREAK_IF(newLines == nullptr);
+            return;
+        }
+        lines = newLines;
+        Memory.resize(MEMORY_CHUNKS, lineCapacity, newCapacity);
+        lineCapacity = newCapacity;
+    }
+
+    s64 delta = (s64)line - (s64)lastLine;
+    lineBytes += writeVarint(lines + lineBytes, offset - lastOffset);
+    lineBytes += writeVarint(lines + lineBytes, ((u64)delta << 1) ^ (u64)(delta >> 63));
+    lastLine = line;
+    lastOffset = offset;
+}
+
+int Chunk::lineAt(u32 offset) const
+{
+    u32 position = 0;
+    u32 start = 0;
+    s64 line = 0;
+    while (position < lineBytes)
+    {
+        start += (u32)readVarint(lines, &position);
+        u64 zigzag = readVarint(lines, &position);
+        if (start > offset) break;
+        line += (s64)(zigzag >> 1) ^ -(s64)(zigzag & 1);
+    }
+    return (int)line;
+}
 
 
 void Chunk::write(u8 instruction, int line)
 {
+    if (segment && !own()) return;
+
     if (m_capacity < count + 1)
     {
         int oldCapacity = m_capacity;
         m_capacity = GROW_CAPACITY(oldCapacity);
         u8 *newCode  = (u8*) (std::realloc(code,  m_capacity * sizeof(u8)));
-        int *newLine = (int*)(std::realloc(lines, m_capacity * sizeof(int)));
-        if (!newCode || !newLine)
+        if (!newCode)
         {
-            std::free(newCode);
-            std::free(newLine);
-            DEBUG_BREAK_IF(newCode == nullptr || newLine == nullptr);
+            m_capacity = oldCapacity;
+            DEBUG_BREAK_IF(newCode == nullptr);
             return;
         }
         code = newCode;
-        lines = newLine;      
+        Memory.resize(MEMORY_CHUNKS, oldCapacity, m_capacity);
+    }
 
+    if (lineBytes == 0 || line != lastLine)
+    {
+        addLine(count, line);
     }
-    
     code[count]  = instruction;
-    lines[count] = line;
     count++;
 }
 
@@ -121,3 +256,108 @@ u8 Chunk::operator[](u32 index)
     DEBUG_BREAK_IF(index > m_capacity);
     return code[index];
 }
+
+
+static void* mapSegment(size_t size)
+{
+#if defined(_WIN32)
+    return VirtualAlloc(nullptr, size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+#else
+    void* block = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    return block == MAP_FAILED ? nullptr : block;
+#endif
+}
+
+static void protectSegment(void* block, size_t size)
+{
+#if defined(_WIN32)
+    DWORD old;
+    VirtualProtect(block, size, PAGE_READONLY, &old);
+#else
+    mprotect(block, size, PROT_READ);
+#endif
+}
+
+static void unmapSegment(void* block, size_t size)
+{
+#if defined(_WIN32)
+    VirtualFree(block, 0, MEM_RELEASE);
+#else
+    munmap(block, size);
+#endif
+}
+
+static size_t pageSize()
+{
+#if defined(_WIN32)
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwPageSize;
+#else
+    return (size_t)sysconf(_SC_PAGESIZE);
+#endif
+}
+
+CodeSegment* CodeSegment::pack(Chunk** chunks, u32 count)
+{
+    size_t codeBytes = 0;
+    size_t lineBytes = 0;
+    u32 packed = 0;
+    for (u32 i = 0; i < count; i++)
+    {
+        if (chunks[i]->segment) continue;
+        codeBytes += chunks[i]->count;
+        lineBytes += chunks[i]->lineBytes;
+        packed++;
+    }
+    if (packed == 0 || codeBytes + lineBytes == 0) return nullptr;
+
+    size_t page = pageSize();
+    size_t size = (codeBytes + lineBytes + page - 1) & ~(page - 1);
+    CodeSegment* segment = new CodeSegment();
+    segment->block = (u8*) mapSegment(size);
+    if (!segment->block)
+    {
+        WARNING("Could not map %zu bytes of code; chunks stay unpacked", size);
+        delete segment;
+        return nullptr;
+    }
+    segment->size = size;
+    segment->users = packed;
+    Memory.allocate(MEMORY_CHUNKS, size, 0);
+
+    u8* code = segment->block;
+    u8* lines = code + codeBytes;
+    for (u32 i = 0; i < count; i++)
+    {
+        Chunk* chunk = chunks[i];
+        if (chunk->segment) continue;
+
+        std::memcpy(code, chunk->code, chunk->count);
+        std::memcpy(lines, chunk->lines, chunk->lineBytes);
+        Memory.release(MEMORY_CHUNKS, chunk->ownedBytes(), 0);
+        std::free(chunk->code);
+        std::free(chunk->lines);
+
+        chunk->code = code;
+        chunk->lines = lines;
+        chunk->m_capacity = chunk->count;
+        chunk->lineCapacity = chunk->lineBytes;
+        chunk->segment = segment;
+        code += chunk->count;
+        lines += chunk->lineBytes;
+    }
+
+    protectSegment(segment->block, size);
+    return segment;
+}
+
+void CodeSegment::release()
+{
+    if (--users == 0)
+    {
+        unmapSegment(block, size);
+        Memory.release(MEMORY_CHUNKS, size, 0);
+        delete this;
+    }
+}
@@ -0,0 +1,170 @@
+#include "VM.hpp"
+
+extern GarbageCollector GC;
+
+// Incremental collection. The roots are the constant table, the globals
+// (names and values) and the stack of every process. Strings are the only collected objects
+// and hold no references, so marking them is all a root scan does.
+//
+// Constants and globals are marked in one go when a cycle starts; after
+// that every global write goes through the write barrier in define(). The
+// process stacks are then marked a few at a time, between ticks. Values
+// can only move between processes through globals (shaded on write) or
+// spawn arguments (the child is appended behind the cursor), so a stack
+// that has already been marked never picks up an unmarked string.
+
+void Interpreter::mark_process(Process* process)
+{
+    for (Value* slot = process->stack; slot < process->stackTop; slot++)
+    {
+        GC.mark(*slot);
+    }
+}
+
+void Interpreter::mark_roots()
+{
+    for (u32 i = 0; i < constants.getSize(); i++)
+    {
+        GC.mark(constants[i]);
+    }
+    globals.for_each([](ObjString* name, const Value& value)
+    {
+        GC.mark(name);
+        GC.mark(value);
+    });
+}
+
+// One slice of the current cycle, at most gc_budget microseconds. Called
+// at the end of every tick, when no process is running. Each slice counts
+// as one pause in the memory report.
+void Interpreter::collect_step()
+{
+    if (gc_budget == 0) return;
+    if (GC.getPhase() == GC_IDLE && !GC.shouldStart()) return;
+
+    u64 start = system_clock.now();
+    collect_slice();
+    memory_history.pause(system_clock.now() - start, GC.getPhase() == GC_IDLE);
+}
+
+void Interpreter::collect_slice()
+{
+    if (GC.shouldStart())
+    {
+        GC.beginMark();
+        mark_roots();
+        gc_cursor = first_instance;
+    }
+
+    u64 deadline = system_clock.now() + gc_budget;
+    if (GC.getPhase() == GC_MARK)
+    {
+        u32 marked = 0;
+        while (gc_cursor)
+        {
+            mark_process(gc_cursor);
+            gc_cursor = gc_cursor->next;
+            if ((++marked & 15) == 0 && system_clock.now() >= deadline) return;
+        }
+
+        // Spawned this tick, not yet in the instance list.
+        for (Process* process = queue_first; process; process = process->next)
+        {
+            mark_process(process);
+        }
+        GC.beginSweep();
+    }
+    GC.sweep(deadline);
+}
+
+// Time the collector may take per tick. 0 turns it off; objects then
+// pile up until collect_garbage() or shutdown.
+void Interpreter::set_gc_budget(u32 microseconds)
+{
+    gc_budget = microseconds;
+}
+
+// Runs a whole cycle now, finishing the one in progress first.
+void Interpreter::collect_garbage()
+{
+    u64 start = system_clock.now();
+    if (GC.getPhase() == GC_IDLE)
+    {
+        GC.beginMark();
+        mark_roots();
+        gc_cursor = first_instance;
+    }
+    if (GC.getPhase() == GC_MARK)
+    {
+        for (; gc_cursor; gc_cursor = gc_cursor->next)
+        {
+            mark_process(gc_cursor);
+        }
+        for (Process* process = queue_first; process; process = process->next)
+        {
+            mark_process(process);
+        }
+        GC.beginSweep();
+    }
+    GC.sweep(UINT64_MAX);
+    memory_history.pause(system_clock.now() - start, true);
+}
+
+void Interpreter::memory_report(MemoryReport* report)
+{
+    for (u32 i = 0; i < MEMORY_CATEGORY_COUNT; i++)
+    {
+        MemoryCategory category = (MemoryCategory)i;
+        s64 bytes = Memory.bytes(category);
+        s64 objects = Memory.objects(category);
+        report->categories[i].bytes = bytes > 0 ? (u64)bytes : 0;
+        report->categories[i].objects = objects > 0 ? (u64)objects : 0;
+        report->categories[i].allocated = Memory.allocated(category);
+    }
+
+    // Sized by their owners rather than counted
+    const SlabHeap& heap = GC.getHeap();
+    MemoryReport::Category& strings = report->categories[MEMORY_STRINGS];
+    strings.bytes = heap.bytesInUse();
+    strings.objects = heap.objectCount();
+    strings.allocated = GC.bytesAllocated();
+
+    MemoryReport::Category& constantBytes = report->categories[MEMORY_CONSTANTS];
+    constantBytes.bytes = (u64)constants.getCapacity() * sizeof(Value);
+    constantBytes.objects = constants.getSize();
+
+    MemoryReport::Category& globalBytes = report->categories[MEMORY_GLOBALS];
+    globalBytes.bytes = (u64)globals.capacity() * sizeof(UnorderedMap<ObjString*, Value>::KeyValuePair);
+    globalBytes.objects = globals.size();
+
+    report->totalBytes = 0;
+    for (u32 i = 0; i < MEMORY_CATEGORY_COUNT; i++)
+    {
+        report->totalBytes += report->categories[i].bytes;
+    }
+
+    report->heapPages = heap.pagesInUse();
+    report->heapPageBytes = heap.pageBytesInUse();
+    report->internedStrings = GC.internedCount();
+
+    memory_history.update(report);
+}
+
+bool Interpreter::dump_memory(FILE* out)
+{
+    if (!out) return false;
+    MemoryReport report;
+    memory_report(&report);
+    if (!report.write(out))
+    {
+        WARNING("Could not write the memory report");
+        return false;
+    }
+    return true;
+}
+
+void Interpreter::set_memory_dump(u32 ticks, FILE* out)
+{
+    memory_dump_ticks = out ? ticks : 0;
+    memory_dump_file = out;
+}
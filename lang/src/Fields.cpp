@@ -0,0 +1,105 @@
+#include "VM.hpp"
+#include "Fields.hpp"
+
+// Indexed by ID_X, ID_Y, ID_ANGLE.
+static const char* fieldNames[FieldStore::FIELD_COUNT] = { "x", "y", "angle" };
+
+
+FieldStore::FieldStore()
+{
+    for (u32 i = 0; i < FIELD_COUNT; i++) columns[i] = nullptr;
+    for (u32 i = 0; i < FIELD_COUNT; i++) previous[i] = nullptr;
+    status = nullptr;
+    owners = nullptr;
+    count = 0;
+    capacity = 0;
+}
+
+FieldStore::~FieldStore()
+{
+    for (u32 i = 0; i < FIELD_COUNT; i++) std::free(columns[i]);
+    for (u32 i = 0; i < FIELD_COUNT; i++) std::free(previous[i]);
+    std::free(status);
+    std::free(owners);
+}
+
+bool FieldStore::grow()
+{
+    u32 newCapacity = capacity < 64 ? 64 : capacity * 2;
+
+    for (u32 i = 0; i < FIELD_COUNT; i++)
+    {
+        double* column = (double*) std::realloc(columns[i], newCapacity * sizeof(double));
+        if (!column) return false;
+        columns[i] = column;
+        double* last = (double*) std::realloc(previous[i], newCapacity * sizeof(double));
+        if (!last) return false;
+        previous[i] = last;
+    }
+    u8* newStatus = (u8*) std::realloc(status, newCapacity * sizeof(u8));
+    if (!newStatus) return false;
+    status = newStatus;
+    Process** newOwners = (Process**) std::realloc(owners, newCapacity * sizeof(Process*));
+    if (!newOwners) return false;
+    owners = newOwners;
+
+    capacity = newCapacity;
+    return true;
+}
+
+u32 FieldStore::add(Process* owner, const double* defaults)
+{
+    if (count >= capacity && !grow())
+    {
+        ERROR("Out of memory for process fields");
+        return NO_ROW;
+    }
+
+    u32 row = count++;
+    for (u32 i = 0; i < FIELD_COUNT; i++) columns[i][row] = defaults[i];
+    for (u32 i = 0; i < FIELD_COUNT; i++) previous[i][row] = defaults[i];
+    status[row] = 0; // hidden until the owner first runs
+    owners[row] = owner;
+    return row;
+}
+
+void FieldStore::remove(u32 row)
+{
+    DEBUG_BREAK_IF(row >= count);
+
+    u32 last = --count;
+    if (row != last)
+    {
+        for (u32 i = 0; i < FIELD_COUNT; i++) columns[i][row] = columns[i][last];
+        for (u32 i = 0; i < FIELD_COUNT; i++) previous[i][row] = previous[i][last];
+        status[row] = status[last];
+        owners[row] = owners[last];
+        owners[row]->field = row;
+    }
+}
+
+// Keeps this tick's starting values so the renderer can blend between
+// the last two ticks.
+void FieldStore::save()
+{
+    if (count == 0) return;
+    for (u32 i = 0; i < FIELD_COUNT; i++)
+    {
+        memcpy(previous[i], columns[i], count * sizeof(double));
+    }
+}
+
+int FieldStore::resolve(const char* name, size_t len)
+{
+    for (u32 i = 0; i < FIELD_COUNT; i++)
+    {
+        if (strlen(fieldNames[i]) == len && memcmp(fieldNames[i], name, len) == 0)
+            return (int)i;
+    }
+    return -1;
+}
+
+const char* FieldStore::name(u32 field)
+{
+    return field < FIELD_COUNT ? fieldNames[field] : "?";
+}
@@ -0,0 +1,83 @@
+#include "VM.hpp"
+#include "Handles.hpp"
+
+
+HandleTable::HandleTable()
+{
+    slots = nullptr;
+    count = 0;
+    capacity = 0;
+    freeHead = NO_SLOT;
+    freeTail = NO_SLOT;
+
+    // Slot 0 is never handed out, so no id is 0 and the first ids are 1, 2, 3...
+    if (grow())
+    {
+        slots[0].process = nullptr;
+        slots[0].generation = GENERATION_MASK;
+        slots[0].nextFree = NO_SLOT;
+        count = 1;
+    }
+}
+
+HandleTable::~HandleTable()
+{
+    std::free(slots);
+}
+
+bool HandleTable::grow()
+{
+    u32 newCapacity = capacity < 64 ? 64 : capacity * 2;
+    if (newCapacity > INDEX_MASK + 1) newCapacity = INDEX_MASK + 1;
+    if (newCapacity <= capacity) return false;
+
+    Slot* newSlots = (Slot*) std::realloc(slots, newCapacity * sizeof(Slot));
+    if (!newSlots) return false;
+    slots = newSlots;
+    capacity = newCapacity;
+    return true;
+}
+
+u32 HandleTable::acquire(Process* process)
+{
+    u32 index;
+    if (freeHead != NO_SLOT)
+    {
+        index = freeHead;
+        freeHead = slots[index].nextFree;
+        if (freeHead == NO_SLOT) freeTail = NO_SLOT;
+    }
+    else
+    {
+        if (count >= capacity && !grow())
+        {
+            ERROR("Too many processes (%u)", count);
+            return 0;
+        }
+        index = count++;
+        slots[index].generation = 0;
+    }
+
+    slots[index].process = process;
+    slots[index].nextFree = NO_SLOT;
+    return (slots[index].generation << INDEX_BITS) | index;
+}
+
+// Freed slots are reused oldest first, which keeps generations from
+// cycling quickly when a few processes are spawned and killed every frame.
+void HandleTable::release(u32 id)
+{
+    u32 index = id & INDEX_MASK;
+    if (index == 0 || index >= count || slots[index].generation != (id >> INDEX_BITS)) return;
+
+    Slot& slot = slots[index];
+    slot.process = nullptr;
+    slot.generation = (slot.generation + 1) & GENERATION_MASK;
+
+    slot.nextFree = NO_SLOT;
+    if (freeTail != NO_SLOT)
+        slots[freeTail].nextFree = index;
+    else
+        freeHead = index;
+    freeTail = index;
+}
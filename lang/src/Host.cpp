@@ -0,0 +1,19 @@
+#include "Host.hpp"
+#include <chrono>
+#include <thread>
+
+
+u64 SystemClock::now()
+{
+    return (u64)std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void SystemClock::wait_until(u64 time)
+{
+    u64 current = now();
+    if (time > current)
+    {
+        std::this_thread::sleep_for(std::chrono::microseconds(time - current));
+    }
+}
@@ -0,0 +1,96 @@
+#include "VM.hpp"
+#include "Intern.hpp"
+#include "Utils.hpp"
+
+// Marks a removed entry so probe chains running through it stay intact.
+static ObjString* const TOMBSTONE = reinterpret_cast<ObjString*>(static_cast<uintptr_t>(1));
+
+
+InternTable::InternTable()
+{
+    entries = nullptr;
+    capacity = 0;
+    used = 0;
+    live = 0;
+}
+
+InternTable::~InternTable()
+{
+    std::free(entries);
+}
+
+ObjString* InternTable::find(const char* text, size_t length, u32 hash) const
+{
+    if (live == 0) return nullptr;
+
+    u32 mask = capacity - 1;
+    for (u32 slot = hash & mask;; slot = (slot + 1) & mask)
+    {
+        ObjString* entry = entries[slot];
+        if (!entry) return nullptr;
+        if (entry != TOMBSTONE && entry->hash == hash && (size_t)entry->length == length &&
+            memcmp(entry->data, text, length) == 0)
+        {
+            return entry;
+        }
+    }
+}
+
+// Rehashes without the tombstones, into a table twice the size unless
+// most of the load was tombstones.
+bool InternTable::grow()
+{
+    u32 newCapacity = capacity < 256 ? 256 : capacity;
+    if (live * 4 >= newCapacity) newCapacity *= 2;
+    ObjString** newEntries = (ObjString**) std::calloc(newCapacity, sizeof(ObjString*));
+    if (!newEntries)
+    {
+        ERROR("Out of memory for the string table");
+        return false;
+    }
+
+    u32 mask = newCapacity - 1;
+    for (u32 i = 0; i < capacity; i++)
+    {
+        ObjString* entry = entries[i];
+        if (!entry || entry == TOMBSTONE) continue;
+        u32 slot = entry->hash & mask;
+        while (newEntries[slot]) slot = (slot + 1) & mask;
+        newEntries[slot] = entry;
+    }
+
+    std::free(entries);
+    entries = newEntries;
+    capacity = newCapacity;
+    used = live;
+    return true;
+}
+
+bool InternTable::insert(ObjString* string)
+{
+    if ((used + 1) * 4 > capacity * 3 && !grow()) return false;
+
+    u32 mask = capacity - 1;
+    u32 slot = string->hash & mask;
+    while (entries[slot] && entries[slot] != TOMBSTONE) slot = (slot + 1) & mask;
+    if (!entries[slot]) used++;
+    entries[slot] = string;
+    live++;
+    return true;
+}
+
+void InternTable::remove(ObjString* string)
+{
+    if (live == 0) return;
+
+    u32 mask = capacity - 1;
+    for (u32 slot = string->hash & mask; entries[slot]; slot = (slot + 1) & mask)
+    {
+        if (entries[slot] == string)
+        {
+            entries[slot] = TOMBSTONE;
+            live--;
+            return;
+        }
+    }
+}
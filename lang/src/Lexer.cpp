@@ -10,7 +10,6 @@ Lexer::Lexer()
     line = 1;
     panicMode = false;
     allocatedBuffer = NULL;
-    initialize();
 }
 
 Lexer::~Lexer() { cleanup(); }
@@ -202,50 +201,75 @@ void Lexer::Error(String message)
 }
 
 
-void Lexer::initialize()
+struct Keyword
 {
+    const char* text;
+    u32 length;
+    TokenType type;
+};
+
+#define KEYWORD(text, type) { text, sizeof(text) - 1, TokenType::type }
+
+static const Keyword keywords[] = {
+    KEYWORD("program", PROGRAM),
+    KEYWORD("nil", NIL),
+    KEYWORD("def", FUNCTION),
+    KEYWORD("process", PROCESS),
+    KEYWORD("and", AND),
+    KEYWORD("or", OR),
+    KEYWORD("not", NOT),
+    KEYWORD("xor", XOR),
+    KEYWORD("if", IF),
+    KEYWORD("else", ELSE),
+    KEYWORD("elif", ELIF),
+    KEYWORD("while", WHILE),
+    KEYWORD("for", FOR),
+    KEYWORD("do", DO),
+    KEYWORD("loop", LOOP),
+    KEYWORD("break", BREAK),
+    KEYWORD("continue", CONTINUE),
+    KEYWORD("return", RETURN),
+    KEYWORD("switch", SWITCH),
+    KEYWORD("case", CASE),
+    KEYWORD("default", DEFAULT),
+    KEYWORD("print", PRINT),
+    KEYWORD("now", NOW),
+    KEYWORD("frame", FRAME),
+    KEYWORD("class", CLASS),
+    KEYWORD("this", THIS),
+    KEYWORD("len", LEN),
+    KEYWORD("import", IMPORT),
+    KEYWORD("var", VAR),
+    KEYWORD("true", TRUE),
+    KEYWORD("false", FALSE),
+};
+
+#undef KEYWORD
+
+static const u32 KEYWORD_MAX = 8;
+
+// Keywords are case-insensitive; the identifier is lowered into a small
+// buffer, nothing is allocated.
+TokenType Lexer::keyword(const char* text, u32 length)
+{
+    if (length > KEYWORD_MAX) return TokenType::IDENTIFIER;
 
-    keywords.insert("program", TokenType::PROGRAM);
-
-    keywords.insert("nil", TokenType::NIL);
-
-    keywords.insert("def", TokenType::FUNCTION);
-    keywords.insert("process", TokenType::PROCESS);
-
-    keywords.insert("and", TokenType::AND);
-    keywords.insert("or", TokenType::OR);
-    keywords.insert("not", TokenType::NOT);
-    keywords.insert("xor", TokenType::XOR);
-
-    keywords.insert("if", TokenType::IF);
-    keywords.insert("else", TokenType::ELSE);
-    keywords.insert("elif", TokenType::ELIF);
-
-    keywords.insert("while", TokenType::WHILE);
-    keywords.insert("for", TokenType::FOR);
-    keywords.insert("do", TokenType::DO);
-
-    keywords.insert("loop", TokenType::LOOP);
-
-    keywords.insert("break", TokenType::BREAK);
-    keywords.insert("continue", TokenType::CONTINUE);
-    keywords.insert("return", TokenType::RETURN);
-    keywords.insert("switch", TokenType::SWITCH);
-    keywords.insert("case", TokenType::CASE);
-    keywords.insert("default", TokenType::DEFAULT);
-
-    keywords.insert("print", TokenType::PRINT);
-    keywords.insert("now", TokenType::NOW);
-    keywords.insert("frame", TokenType::FRAME);
-    keywords.insert("class", TokenType::CLASS);
-    keywords.insert("this", TokenType::THIS);
-    keywords.insert("len", TokenType::LEN);
-
-    keywords.insert("import", TokenType::IMPORT);
+    char lower[KEYWORD_MAX];
+    for (u32 i = 0; i < length; i++)
+    {
+        char c = text[i];
+        lower[i] = (c >= 'A' && c <= 'Z') ? (char)(c + ('a' - 'A')) : c;
+    }
 
-    keywords.insert("var", TokenType::VAR);
-    keywords.insert("true", TokenType::TRUE);
-    keywords.insert("false", TokenType::FALSE);
+    for (const Keyword& word : keywords)
+    {
+        if (word.length == length && word.text[0] == lower[0] &&
+            memcmp(word.text, lower, length) == 0)
+        {
+            return word.type;
+        }
+    }
+    return TokenType::IDENTIFIER;
 }
 
 
@@ -261,18 +285,12 @@ Token Lexer::string()
     if (isAtEnd())
     {
         Error("Unterminated string");
-        return Token(TokenType::ERROR, "Unterminated string", "ERROR", line);
+        return Token(TokenType::ERROR, "Unterminated string", line);
     }
 
     advance();
 
-
-     const char* stringStart = start + 1;          
-     int stringLength = (int)(current - start) - 2;
-    String text(stringStart, stringLength);
-
-    Token token = Token(TokenType::STRING, std::move(text), "", line);
-     return token;
+    return Token(TokenType::STRING, start + 1, (u32)(current - start) - 2, line);
 }
 
 Token Lexer::number()
@@ -285,56 +303,24 @@ Token Lexer::number()
         while (isDigit(peek())) advance();
     }
 
-    String text(start, (int)(current - start));
-    return addToken(TokenType::NUMBER, text);
+    Token token = addToken(TokenType::NUMBER);
+    if (!parseNumber(start, (size_t)(current - start), &token.number))
+    {
+        token.number = 0;
+    }
+    return token;
 }
 
-Token Lexer::addToken(TokenType type, String literal)
+Token Lexer::addToken(TokenType type)
 {
-
-    String text(start, (int)(current - start));
-    Token token = Token(type, std::move(text), std::move(literal), line);
-    return token;
+    return Token(type, start, (u32)(current - start), line);
 }
 
 Token Lexer::identifier()
 {
-
     while (isAlphaNumeric(peek())) advance();
 
-    // std::cout<<" ,"<<peek()<<" ";
-
-    String text(start, (int)(current - start));
-    text.ToLower(); 
-
-    // if (keywords.contains(text))
-    // {
-    //     TokenType type = keywords[text];
-    //     WARNING("keyword: %s", text.c_str());
-    //     return addToken(type);
-    // }
-    // else
-    // {
-    //     WARNING("identifier: %s", text.c_str());
-    //     return addToken(TokenType::IDENTIFIER, text);
-    // }
-
-
- 
-    TokenType* type = keywords.find(text);
-    if (type != nullptr)
-    {
-      //  WARNING("keyword: %s", text.c_str());
-        return addToken(*type);
-    }
-    else
-    {
-      //  WARNING("identifier: %s", text.c_str());
-        return addToken(TokenType::IDENTIFIER, text);
-    }
-
-
-    return Token(TokenType::ERROR, "UNKNOWN", "indentifier", line);
+    return addToken(keyword(start, (u32)(current - start)));
 }
 
 Token Lexer::scanToken()
@@ -346,7 +332,7 @@ Token Lexer::scanToken()
 
     if (isAtEnd()) 
     {
-       return Token(TokenType::END_OF_FILE, "EOF", "EOF", line);
+       return Token(TokenType::END_OF_FILE, "EOF", line);
     }
 
     char c = advance();
@@ -446,7 +432,7 @@ Token Lexer::scanToken()
 
 
     Error("Unexpected character");
-    return Token(TokenType::ERROR, "Unexpected character", "", line);
+    return Token(TokenType::ERROR, "Unexpected character", line);
 }
 
  
@@ -540,7 +526,7 @@ void Lexer::print()
         {
             printf("   | ");
         }
-        printf("%2d '%s'   %s \n", (int)token.type, token.lexeme.c_str(),tknString(token.type).c_str());
+        printf("%2d '%.*s'   %s \n", (int)token.type, (int)token.length, token.lexeme, tknString(token.type).c_str());
 
         if (token.type == TokenType::END_OF_FILE) break;
     }
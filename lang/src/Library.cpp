@@ -0,0 +1,101 @@
+#include "VM.hpp"
+#include "Utils.hpp"
+#include <cmath>
+#include <cstdlib>
+
+// Natives every host wants: output, time and math. Shared by the windowed
+// and the headless front ends.
+
+static Value clockNative(int argCount, Value* args) 
+{
+  return NUMBER((double)clock() / CLOCKS_PER_SEC);
+}
+
+static Value write_Native(int argCount, Value* args) 
+{
+  for (int i = 0; i < argCount; i++) 
+  {
+    PRINT_VALUE(args[i]);
+  }
+
+  return NIL();
+}
+static Value writeln_Native(int argCount, Value* args) 
+{
+  for (int i = 0; i < argCount; i++) 
+  {
+    PRINT_VALUE(args[i]);
+  }
+  printf("\n");
+  return NIL();
+}
+
+// Random number generator (returns [0,1))
+static Value rand_native(int argCount, Value* args) {
+    return NUMBER(static_cast<double>(std::rand()) / RAND_MAX);
+}
+
+// Returns a double in [min, max]
+static Value random_native(int argCount, Value* args) 
+{
+    if (argCount != 2 || !IS_NUMBER(args[0]) || !IS_NUMBER(args[1]))
+        return NIL();
+
+    double min = AS_NUMBER(args[0]);
+    double max = AS_NUMBER(args[1]);
+
+    if (min > max) 
+    {
+        double temp = min;
+        min = max;
+        max = temp;
+    }
+
+    // Generate a double in [0, 1)
+    double r = (double)std::rand() / ((double)RAND_MAX + 1.0);
+
+    // Scale to [min, max]
+    double result = min + r * (max - min);
+
+    return NUMBER(result);
+}
+
+
+// Absolute value
+static Value abs_native(int argCount, Value* args) {
+    if (argCount != 1 || !IS_NUMBER(args[0])) return NIL();
+    return NUMBER(std::fabs(AS_NUMBER(args[0])));
+}
+
+// Sine function (radians)
+static Value sin_native(int argCount, Value* args) {
+    if (argCount != 1 || !IS_NUMBER(args[0])) return NIL();
+    return NUMBER(std::sin(AS_NUMBER(args[0])));
+}
+
+// Cosine function (radians)
+static Value cos_native(int argCount, Value* args) {
+    if (argCount != 1 || !IS_NUMBER(args[0])) return NIL();
+    return NUMBER(std::cos(AS_NUMBER(args[0])));
+}
+
+// Tangent function (radians)
+static Value tan_native(int argCount, Value* args) {
+    if (argCount != 1 || !IS_NUMBER(args[0])) return NIL();
+    return NUMBER(std::tan(AS_NUMBER(args[0])));
+}
+
+
+void Interpreter::defineStandardNatives()
+{
+    defineNative("clock", clockNative);
+    defineNative("write", write_Native);
+    defineNative("writeln", writeln_Native);
+
+    defineNative("rand", rand_native);
+    defineNative("random", random_native);
+    defineNative("abs", abs_native, true);
+    defineNative("sin", sin_native, true);
+    defineNative("cos", cos_native, true);
+    defineNative("tan", tan_native, true);
+}
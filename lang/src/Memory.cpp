@@ -0,0 +1,166 @@
+#include "Memory.hpp"
+#include <cstdarg>
+#include <cstring>
+
+MemoryCounters Memory;
+
+static const char* categoryNames[MEMORY_CATEGORY_COUNT] =
+{
+    "strings",
+    "functions",
+    "processes",
+    "stacks",
+    "chunks",
+    "constants",
+    "globals",
+};
+
+const u32 MemoryReport::pauseLimits[PAUSE_BUCKETS - 1] =
+{
+    25, 50, 100, 250, 500, 1000, 2500, 5000, 10000, 25000
+};
+
+const char* memoryCategoryName(u32 category)
+{
+    return category < MEMORY_CATEGORY_COUNT ? categoryNames[category] : "unknown";
+}
+
+bool memoryCategoryFind(const char* name, MemoryCategory* category)
+{
+    for (u32 i = 0; i < MEMORY_CATEGORY_COUNT; i++)
+    {
+        if (strcmp(name, categoryNames[i]) == 0)
+        {
+            *category = (MemoryCategory)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Keeps counting past a full buffer so the caller learns the size needed.
+static void append(char* buffer, size_t size, size_t* length, const char* format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    int written = vsnprintf(*length < size ? buffer + *length : nullptr,
+                            *length < size ? size - *length : 0, format, args);
+    va_end(args);
+    if (written > 0) *length += (size_t)written;
+}
+
+int MemoryReport::format(char* buffer, size_t size) const
+{
+    size_t length = 0;
+    append(buffer, size, &length, "{\"tick\":%llu,\"bytes\":%llu,\"peak\":%llu,\"categories\":{",
+           (unsigned long long)tick, (unsigned long long)totalBytes, (unsigned long long)totalPeak);
+    for (u32 i = 0; i < MEMORY_CATEGORY_COUNT; i++)
+    {
+        const Category& category = categories[i];
+        append(buffer, size, &length, "%s\"%s\":{\"bytes\":%llu,\"objects\":%llu,\"peak\":%llu,\"allocated\":%llu}",
+               i ? "," : "", categoryNames[i],
+               (unsigned long long)category.bytes, (unsigned long long)category.objects,
+               (unsigned long long)category.peak, (unsigned long long)category.allocated);
+    }
+    append(buffer, size, &length, "},\"heap\":{\"pages\":%llu,\"page_bytes\":%llu,\"interned\":%llu}",
+           (unsigned long long)heapPages, (unsigned long long)heapPageBytes,
+           (unsigned long long)internedStrings);
+    append(buffer, size, &length, ",\"tick_allocated\":{\"last\":%llu,\"max\":%llu,\"average\":%llu}",
+           (unsigned long long)tickAllocated, (unsigned long long)tickAllocatedMax,
+           (unsigned long long)tickAllocatedAverage);
+    append(buffer, size, &length, ",\"gc\":{\"cycles\":%llu,\"pauses\":%llu,\"pause_total_us\":%llu,\"pause_max_us\":%llu,\"histogram\":[",
+           (unsigned long long)gcCycles, (unsigned long long)gcPauses,
+           (unsigned long long)gcPauseTotal, (unsigned long long)gcPauseMax);
+    for (u32 i = 0; i < PAUSE_BUCKETS; i++)
+    {
+        append(buffer, size, &length, "%s%llu", i ? "," : "", (unsigned long long)gcPauseHistogram[i]);
+    }
+    append(buffer, size, &length, "]}}");
+    return (int)length;
+}
+
+bool MemoryReport::write(FILE* out) const
+{
+    char buffer[2048];
+    int length = format(buffer, sizeof(buffer));
+    if (length < 0 || (size_t)length >= sizeof(buffer)) return false;
+    buffer[length] = '\n';
+    return fwrite(buffer, 1, (size_t)length + 1, out) == (size_t)length + 1 && fflush(out) == 0;
+}
+
+
+MemoryHistory::MemoryHistory()
+{
+    clear();
+}
+
+void MemoryHistory::clear()
+{
+    memset(peaks, 0, sizeof(peaks));
+    totalPeak = 0;
+    lastAllocated = 0;
+    ticks = 0;
+    tickAllocated = 0;
+    tickAllocatedMax = 0;
+    tickAllocatedSum = 0;
+    cycles = 0;
+    pauses = 0;
+    pauseTotal = 0;
+    pauseMax = 0;
+    memset(histogram, 0, sizeof(histogram));
+}
+
+// Peaks only move here and at tick ends: the counted categories could
+// track them on every allocation, but the derived ones (strings, constants,
+// globals) cannot, and mixed precision would make the totals lie.
+void MemoryHistory::update(MemoryReport* report)
+{
+    for (u32 i = 0; i < MEMORY_CATEGORY_COUNT; i++)
+    {
+        MemoryReport::Category& category = report->categories[i];
+        if (category.bytes > peaks[i]) peaks[i] = category.bytes;
+        category.peak = peaks[i];
+    }
+    if (report->totalBytes > totalPeak) totalPeak = report->totalBytes;
+    report->totalPeak = totalPeak;
+
+    report->tick = ticks;
+    report->tickAllocated = tickAllocated;
+    report->tickAllocatedMax = tickAllocatedMax;
+    report->tickAllocatedAverage = ticks ? tickAllocatedSum / ticks : 0;
+
+    report->gcCycles = cycles;
+    report->gcPauses = pauses;
+    report->gcPauseTotal = pauseTotal;
+    report->gcPauseMax = pauseMax;
+    memcpy(report->gcPauseHistogram, histogram, sizeof(histogram));
+}
+
+void MemoryHistory::endTick(const MemoryReport& report)
+{
+    u64 allocated = 0;
+    for (u32 i = 0; i < MEMORY_CATEGORY_COUNT; i++)
+    {
+        allocated += report.categories[i].allocated;
+    }
+    // The first tick also pays for whatever was allocated while compiling
+    tickAllocated = allocated - lastAllocated;
+    lastAllocated = allocated;
+    if (tickAllocated > tickAllocatedMax) tickAllocatedMax = tickAllocated;
+    tickAllocatedSum += tickAllocated;
+    ticks++;
+}
+
+void MemoryHistory::pause(u64 microseconds, bool cycleDone)
+{
+    u32 bucket = 0;
+    while (bucket < MemoryReport::PAUSE_BUCKETS - 1 && microseconds > MemoryReport::pauseLimits[bucket])
+    {
+        bucket++;
+    }
+    histogram[bucket]++;
+    pauses++;
+    pauseTotal += microseconds;
+    if (microseconds > pauseMax) pauseMax = microseconds;
+    if (cycleDone) cycles++;
+}
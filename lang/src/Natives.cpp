@@ -0,0 +1,409 @@
+#include "VM.hpp"
+
+// Natives that need the calling process. They are registered by the
+// Interpreter itself, so every script sees them without the host having to.
+
+// Process ids travel as numbers; anything else maps to 0, which is never
+// a valid id.
+static u32 toId(const Value& value)
+{
+    if (!IS_NUMBER(value)) return 0;
+    double id = AS_NUMBER(value);
+    if (id < 1 || id > 4294967295.0) return 0;
+    return (u32)id;
+}
+
+
+// priority()        -> priority of the caller
+// priority(id)      -> priority of process id, nil if it is gone
+static Value priority_Native(Process* process, int argCount, Value* args)
+{
+    Process* target = process;
+    if (argCount >= 1)
+    {
+        target = process->getInterpreter()->find_process(toId(args[0]));
+        if (!target) return NIL();
+    }
+    return NUMBER(target->priority);
+}
+
+// set_priority(p)      -> caller
+// set_priority(id, p)  -> process id
+// Returns false when the process does not exist.
+static Value set_priority_Native(Process* process, int argCount, Value* args)
+{
+    if (argCount < 1) return BOOLEAN(false);
+
+    Process* target = process;
+    s32 priority = AS_INTEGER(args[0]);
+    if (argCount >= 2)
+    {
+        target = process->getInterpreter()->find_process(toId(args[0]));
+        priority = AS_INTEGER(args[1]);
+        if (!target) return BOOLEAN(false);
+    }
+    process->getInterpreter()->set_priority(target, priority);
+    return BOOLEAN(true);
+}
+
+// get_id() -> id of the caller
+static Value get_id_Native(Process* process, int argCount, Value* args)
+{
+    return NUMBER(process->id);
+}
+
+// exists(id) -> true while process id is alive. Safe on stale ids. Not
+// thread-safe: the other process's worker may be changing its status.
+static Value exists_Native(Process* process, int argCount, Value* args)
+{
+    if (argCount < 1) return BOOLEAN(false);
+    return BOOLEAN(process->getInterpreter()->process_exists(toId(args[0])));
+}
+
+// Signal numbers follow DIV: s_kill, s_wakeup, s_sleep, s_freeze, and the
+// same plus S_TREE for the _tree variants that also reach descendants.
+enum Signal
+{
+    S_KILL = 0,
+    S_WAKEUP = 1,
+    S_SLEEP = 2,
+    S_FREEZE = 3,
+    S_TREE = 100,
+};
+
+static bool signalStatus(const Value& value, ProcessStatus* status, bool* tree)
+{
+    if (!IS_NUMBER(value)) return false;
+    int signal = AS_INTEGER(value);
+    *tree = signal >= S_TREE;
+    if (*tree) signal -= S_TREE;
+    switch (signal)
+    {
+        case S_KILL: *status = STATUS_KILLED; return true;
+        case S_WAKEUP: *status = STATUS_RUNNING; return true;
+        case S_SLEEP: *status = STATUS_SLEEPING; return true;
+        case S_FREEZE: *status = STATUS_FROZEN; return true;
+        default: return false;
+    }
+}
+
+// Sends status to a process id or to every instance of a process type,
+// optionally with their descendants. Returns how many processes were
+// reached.
+static u32 signalTarget(Process* process, const Value& target, ProcessStatus status, bool tree)
+{
+    Interpreter* vm = process->getInterpreter();
+    if (IS_PROCESS(target))
+    {
+        ProcessBlueprint* blueprint = AS_PROCESS(target)->blueprint;
+        if (!tree) return vm->signal_type(blueprint, status);
+
+        u32 count = 0;
+        SchedLink* list = &blueprint->instances;
+        if (status == STATUS_KILLED)
+        {
+            // A killed subtree can take later instances of the same type
+            // with it, so always restart from the head.
+            while (!list->empty())
+            {
+                count += vm->signal_tree(list->next->owner, status);
+            }
+        }
+        else
+        {
+            for (SchedLink* node = list->next; node != list; node = node->next)
+            {
+                count += vm->signal_tree(node->owner, status);
+            }
+        }
+        return count;
+    }
+
+    Process* other = vm->find_process(toId(target));
+    if (!other || !other->is_alive()) return 0;
+    if (tree) return vm->signal_tree(other, status);
+    vm->set_status(other, status);
+    return 1;
+}
+
+// kill(id) / kill(type) -> false when nothing was killed
+static Value kill_Native(Process* process, int argCount, Value* args)
+{
+    if (argCount < 1) return BOOLEAN(false);
+    return BOOLEAN(signalTarget(process, args[0], STATUS_KILLED, false) > 0);
+}
+
+// signal(id, s) / signal(type, s) -> number of processes signalled
+static Value signal_Native(Process* process, int argCount, Value* args)
+{
+    ProcessStatus status;
+    bool tree;
+    if (argCount < 2 || !signalStatus(args[1], &status, &tree)) return NUMBER(0);
+    return NUMBER(signalTarget(process, args[0], status, tree));
+}
+
+// count(type) -> live instances of type
+static Value count_Native(Process* process, int argCount, Value* args)
+{
+    if (argCount < 1 || !IS_PROCESS(args[0])) return NUMBER(0);
+    return NUMBER(AS_PROCESS(args[0])->blueprint->instanceCount);
+}
+
+// first(type) -> id of the oldest live instance of type, 0 if none
+static Value first_Native(Process* process, int argCount, Value* args)
+{
+    if (argCount < 1 || !IS_PROCESS(args[0])) return NUMBER(0);
+    SchedLink* list = &AS_PROCESS(args[0])->blueprint->instances;
+    if (list->empty()) return NUMBER(0);
+    return NUMBER(list->next->owner->id);
+}
+
+// next(id) -> id of the next live instance of the same type, 0 at the end
+//
+//   var b = first(bala);
+//   while (b) { ...; b = next(b); }
+static Value next_Native(Process* process, int argCount, Value* args)
+{
+    if (argCount < 1) return NUMBER(0);
+    Process* current = process->getInterpreter()->find_process(toId(args[0]));
+    if (!current || !current->blueprint) return NUMBER(0);
+    SchedLink* node = current->instanceLink.next;
+    if (!current->instanceLink.linked() || node == &current->blueprint->instances) return NUMBER(0);
+    return NUMBER(node->owner->id);
+}
+
+// father() / father(id) -> id of the spawning process, 0 once it has died
+static Value father_Native(Process* process, int argCount, Value* args)
+{
+    Process* target = argCount >= 1 ? process->getInterpreter()->find_process(toId(args[0])) : process;
+    if (!target || !target->father) return NUMBER(0);
+    return NUMBER(target->father->id);
+}
+
+// son() / son(id) -> id of the most recently spawned live child, 0 if none
+static Value son_Native(Process* process, int argCount, Value* args)
+{
+    Process* target = argCount >= 1 ? process->getInterpreter()->find_process(toId(args[0])) : process;
+    if (!target || target->children.empty()) return NUMBER(0);
+    return NUMBER(target->children.prev->owner->id);
+}
+
+// group_scheduling(enabled) -> run instances of one type back to back
+static Value group_scheduling_Native(Process* process, int argCount, Value* args)
+{
+    bool enabled = argCount < 1 || IS_TRUTHY(args[0]);
+    process->getInterpreter()->set_group_scheduling(enabled);
+    return NIL();
+}
+
+
+void Interpreter::defineProcessNatives()
+{
+    defineProcessNative("priority", priority_Native, true);
+    defineProcessNative("set_priority", set_priority_Native);
+    defineProcessNative("get_id", get_id_Native, true);
+    defineProcessNative("exists", exists_Native);
+    defineProcessNative("kill", kill_Native);
+    defineProcessNative("signal", signal_Native);
+    defineProcessNative("count", count_Native, true);
+    defineProcessNative("first", first_Native, true);
+    defineProcessNative("next", next_Native, true);
+    defineProcessNative("father", father_Native, true);
+    defineProcessNative("son", son_Native, true);
+    defineProcessNative("group_scheduling", group_scheduling_Native);
+
+    define("S_KILL", NUMBER(S_KILL));
+    define("S_WAKEUP", NUMBER(S_WAKEUP));
+    define("S_SLEEP", NUMBER(S_SLEEP));
+    define("S_FREEZE", NUMBER(S_FREEZE));
+    define("S_KILL_TREE", NUMBER(S_TREE + S_KILL));
+    define("S_WAKEUP_TREE", NUMBER(S_TREE + S_WAKEUP));
+    define("S_SLEEP_TREE", NUMBER(S_TREE + S_SLEEP));
+    define("S_FREEZE_TREE", NUMBER(S_TREE + S_FREEZE));
+}
+
+
+// Keyboard and mouse, read through the interpreter's InputSource so the
+// same scripts run against a window, a recording or nothing at all.
+
+// The key or button a native was called with; a runtime error in the
+// caller when it is missing or not a number.
+static bool inputCode(Process* process, const char* native, int argCount, Value* args, int* code)
+{
+    if (argCount < 1 || !IS_NUMBER(args[0]))
+    {
+        process->runtimeError(String(native) + "() expects a key or button number.");
+        return false;
+    }
+    *code = AS_INTEGER(args[0]);
+    return true;
+}
+
+static Value key_down_Native(Process* process, int argCount, Value* args)
+{
+    int code;
+    if (!inputCode(process, "key_down", argCount, args, &code)) return NIL();
+    return BOOLEAN(process->getInterpreter()->get_input()->key_down(code));
+}
+
+static Value key_pressed_Native(Process* process, int argCount, Value* args)
+{
+    int code;
+    if (!inputCode(process, "key_pressed", argCount, args, &code)) return NIL();
+    return BOOLEAN(process->getInterpreter()->get_input()->key_pressed(code));
+}
+
+static Value key_released_Native(Process* process, int argCount, Value* args)
+{
+    int code;
+    if (!inputCode(process, "key_released", argCount, args, &code)) return NIL();
+    return BOOLEAN(process->getInterpreter()->get_input()->key_released(code));
+}
+
+static Value key_up_Native(Process* process, int argCount, Value* args)
+{
+    int code;
+    if (!inputCode(process, "key_up", argCount, args, &code)) return NIL();
+    return BOOLEAN(!process->getInterpreter()->get_input()->key_down(code));
+}
+
+static Value mouse_x_Native(Process* process, int argCount, Value* args)
+{
+    return NUMBER(process->getInterpreter()->get_input()->mouse_x());
+}
+
+static Value mouse_y_Native(Process* process, int argCount, Value* args)
+{
+    return NUMBER(process->getInterpreter()->get_input()->mouse_y());
+}
+
+static Value mouse_down_Native(Process* process, int argCount, Value* args)
+{
+    int code;
+    if (!inputCode(process, "mouse_down", argCount, args, &code)) return NIL();
+    return BOOLEAN(process->getInterpreter()->get_input()->mouse_down(code));
+}
+
+static Value mouse_pressed_Native(Process* process, int argCount, Value* args)
+{
+    int code;
+    if (!inputCode(process, "mouse_pressed", argCount, args, &code)) return NIL();
+    return BOOLEAN(process->getInterpreter()->get_input()->mouse_pressed(code));
+}
+
+static Value mouse_released_Native(Process* process, int argCount, Value* args)
+{
+    int code;
+    if (!inputCode(process, "mouse_released", argCount, args, &code)) return NIL();
+    return BOOLEAN(process->getInterpreter()->get_input()->mouse_released(code));
+}
+
+static Value mouse_up_Native(Process* process, int argCount, Value* args)
+{
+    int code;
+    if (!inputCode(process, "mouse_up", argCount, args, &code)) return NIL();
+    return BOOLEAN(!process->getInterpreter()->get_input()->mouse_down(code));
+}
+
+void Interpreter::defineInputNatives()
+{
+    defineProcessNative("key_down", key_down_Native);
+    defineProcessNative("key_pressed", key_pressed_Native);
+    defineProcessNative("key_released", key_released_Native);
+    defineProcessNative("key_up", key_up_Native);
+
+    defineProcessNative("mouse_down", mouse_down_Native);
+    defineProcessNative("mouse_pressed", mouse_pressed_Native);
+    defineProcessNative("mouse_released", mouse_released_Native);
+    defineProcessNative("mouse_up", mouse_up_Native);
+
+    defineProcessNative("mouse_x", mouse_x_Native);
+    defineProcessNative("mouse_y", mouse_y_Native);
+}
+
+
+// Memory statistics, see Interpreter::memory_report. Without an argument
+// they cover everything; with a category name ("strings", "functions",
+// "processes", "stacks", "chunks", "constants", "globals") just that one,
+// or nil when the name is unknown.
+static bool memoryCategory(int argCount, Value* args, MemoryCategory* category, bool* all)
+{
+    *all = argCount < 1;
+    if (*all) return true;
+    if (!IS_STRING(args[0])) return false;
+    return memoryCategoryFind(AS_STRING(args[0])->data, category);
+}
+
+// memory_bytes([category]) -> live bytes
+static Value memory_bytes_Native(Process* process, int argCount, Value* args)
+{
+    MemoryCategory category;
+    bool all;
+    if (!memoryCategory(argCount, args, &category, &all)) return NIL();
+    MemoryReport report;
+    process->getInterpreter()->memory_report(&report);
+    return NUMBER((double)(all ? report.totalBytes : report.categories[category].bytes));
+}
+
+// memory_objects([category]) -> live objects
+static Value memory_objects_Native(Process* process, int argCount, Value* args)
+{
+    MemoryCategory category;
+    bool all;
+    if (!memoryCategory(argCount, args, &category, &all)) return NIL();
+    MemoryReport report;
+    process->getInterpreter()->memory_report(&report);
+    if (!all) return NUMBER((double)report.categories[category].objects);
+    u64 objects = 0;
+    for (u32 i = 0; i < MEMORY_CATEGORY_COUNT; i++) objects += report.categories[i].objects;
+    return NUMBER((double)objects);
+}
+
+// memory_peak([category]) -> most live bytes seen so far
+static Value memory_peak_Native(Process* process, int argCount, Value* args)
+{
+    MemoryCategory category;
+    bool all;
+    if (!memoryCategory(argCount, args, &category, &all)) return NIL();
+    MemoryReport report;
+    process->getInterpreter()->memory_report(&report);
+    return NUMBER((double)(all ? report.totalPeak : report.categories[category].peak));
+}
+
+// memory_rate() -> bytes allocated during the last tick
+static Value memory_rate_Native(Process* process, int argCount, Value* args)
+{
+    MemoryReport report;
+    process->getInterpreter()->memory_report(&report);
+    return NUMBER((double)report.tickAllocated);
+}
+
+// gc_pause_max() -> longest collector pause so far, in microseconds
+static Value gc_pause_max_Native(Process* process, int argCount, Value* args)
+{
+    MemoryReport report;
+    process->getInterpreter()->memory_report(&report);
+    return NUMBER((double)report.gcPauseMax);
+}
+
+// memory_report() -> the whole report as one line of JSON
+static Value memory_report_Native(Process* process, int argCount, Value* args)
+{
+    MemoryReport report;
+    process->getInterpreter()->memory_report(&report);
+    char buffer[2048];
+    int length = report.format(buffer, sizeof(buffer));
+    if (length < 0 || (size_t)length >= sizeof(buffer)) return NIL();
+    return STRING(buffer, (size_t)length);
+}
+
+// Not thread-safe: a report reads the heap, which workers write to.
+void Interpreter::defineMemoryNatives()
+{
+    defineProcessNative("memory_bytes", memory_bytes_Native);
+    defineProcessNative("memory_objects", memory_objects_Native);
+    defineProcessNative("memory_peak", memory_peak_Native);
+    defineProcessNative("memory_rate", memory_rate_Native);
+    defineProcessNative("gc_pause_max", gc_pause_max_Native);
+    defineProcessNative("memory_report", memory_report_Native);
+}
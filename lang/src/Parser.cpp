@@ -2,7 +2,6 @@
 #include "VM.hpp"
 #include "Token.hpp"
 #include "Lexer.hpp"
-#include <string>
 
 
 typedef void (*ParseFn)(bool);
@@ -143,7 +142,7 @@ void Parser::errorAt(const Token& token, const String& message)
     }
     else
     {
-        ERROR("[line %d] Error '%s' at  %s ", token.line, token.lexeme.c_str(),
+        ERROR("[line %d] Error '%.*s' at  %s ", token.line, (int)token.length, token.lexeme,
               message.c_str());
     }
 
@@ -191,8 +190,13 @@ void Parser::emitBytes(u8 byte1, u8 byte2)
 
 void Parser::endProcess()
 {
-    current_process->writeChunk(OP_HALT, 0);
-    current_process->call(current_function, 0);
+    emitByte(OP_HALT);
+    current_function->maxStack = measureStack(current_function, 0);
+    current_blueprint->maxStack = current_function->maxStack;
+    finishFunction(current_function);
+    // Code moves when it is packed, so the main frame starts after that
+    packCode();
+    vm->main_process->call(current_function, 0);
 }
 
 int Parser::emitJump(u8 instruction)
@@ -226,6 +230,138 @@ void Parser::patchJump(int offset)
 
 
 
+static u32 instructionLength(u8 instruction)
+{
+    switch (instruction)
+    {
+        case OP_CONSTANT:
+        case OP_CALL:
+        case OP_GET_LOCAL:
+        case OP_SET_LOCAL:
+        case OP_GET_FIELD:
+        case OP_SET_FIELD:
+        case OP_DEFINE_LOCAL:
+        case OP_GET_GLOBAL:
+        case OP_DEFINE_GLOBAL:
+        case OP_SET_GLOBAL:
+        case OP_CONCAT: return 2;
+        case OP_JUMP:
+        case OP_JUMP_IF_FALSE:
+        case OP_JUMP_IF_TRUE:
+        case OP_LOOP: return 3;
+        default: return 1;
+    }
+}
+
+static int stackEffect(u8 instruction, u8 operand)
+{
+    switch (instruction)
+    {
+        case OP_CONSTANT:
+        case OP_NIL:
+        case OP_TRUE:
+        case OP_FALSE:
+        case OP_DUP:
+        case OP_NOW:
+        case OP_GET_LOCAL:
+        case OP_GET_FIELD:
+        case OP_GET_GLOBAL: return 1;
+
+        case OP_POP:
+        case OP_PRINT:
+        case OP_FRAME:
+        case OP_DEFINE_LOCAL:
+        case OP_DEFINE_GLOBAL:
+        case OP_ADD:
+        case OP_SUBTRACT:
+        case OP_MULTIPLY:
+        case OP_DIVIDE:
+        case OP_MODULO:
+        case OP_POWER:
+        case OP_AND:
+        case OP_OR:
+        case OP_XOR:
+        case OP_BANG_EQUAL:
+        case OP_GREATER_EQUAL:
+        case OP_LESS_EQUAL:
+        case OP_NOT_EQUAL:
+        case OP_EQUAL:
+        case OP_GREATER:
+        case OP_LESS: return -1;
+
+        case OP_CALL: return -(int)operand; // callee slot keeps the result
+        case OP_CONCAT: return 1 - (int)operand;
+
+        default: return 0;
+    }
+}
+
+// Walks every reachable path through the chunk and returns the deepest
+// stack it can reach, counting from the frame's first slot.
+u32 Parser::measureStack(ObjFunction* function, u32 baseDepth)
+{
+    Chunk& chunk = function->chunk;
+    if (chunk.count == 0) return baseDepth;
+
+    // Every offset is queued at most once, so count slots hold the queue.
+    Arena::Mark scratch = arena.mark();
+    int* depths = arena.allocate<int>(chunk.count);
+    u32* pending = arena.allocate<u32>(chunk.count);
+    if (!depths || !pending)
+    {
+        arena.rewind(scratch);
+        outOfMemory();
+        return baseDepth;
+    }
+    for (u32 i = 0; i < chunk.count; i++) depths[i] = -1;
+
+    u32 pendingCount = 0;
+    pending[pendingCount++] = 0;
+    depths[0] = baseDepth;
+    int maxDepth = baseDepth;
+
+    while (pendingCount > 0)
+    {
+        u32 offset = pending[--pendingCount];
+        u8 instruction = chunk.code[offset];
+        u32 length = instructionLength(instruction);
+        if (instruction == OP_HALT || instruction == OP_RETURN) continue;
+        if (offset + length > chunk.count) continue;
+
+        u8 operand = length > 1 ? chunk.code[offset + 1] : 0;
+        int depth = depths[offset] + stackEffect(instruction, operand);
+        if (depth > maxDepth) maxDepth = depth;
+
+        u32 next[2];
+        int nextCount = 0;
+        u16 jump = length == 3 ? (u16)((chunk.code[offset + 1] << 8) | chunk.code[offset + 2]) : 0;
+        switch (instruction)
+        {
+            case OP_JUMP: next[nextCount++] = offset + 3 + jump; break;
+            case OP_LOOP: next[nextCount++] = offset + 3 - jump; break;
+            case OP_JUMP_IF_FALSE:
+            case OP_JUMP_IF_TRUE:
+                next[nextCount++] = offset + 3;
+                next[nextCount++] = offset + 3 + jump;
+                break;
+            default: next[nextCount++] = offset + length; break;
+        }
+
+        for (int i = 0; i < nextCount; i++)
+        {
+            if (next[i] < chunk.count && depths[next[i]] == -1)
+            {
+                depths[next[i]] = depth;
+                pending[pendingCount++] = next[i];
+            }
+        }
+    }
+
+    arena.rewind(scratch);
+    return (u32)maxDepth;
+}
+
+
 void Parser::synchronize()
 {
     panic_mode = false;
@@ -263,6 +399,12 @@ Parser::Parser(Interpreter* vm)
     panic_mode = false;
     lexer = new Lexer();
     call_return = false;
+    exhausted = false;
+    loop = nullptr;
+    finished = nullptr;
+    finishedCount = 0;
+    current_blueprint = nullptr;
+    current_function = nullptr;
 }
 
 Parser::~Parser() { delete lexer; }
@@ -271,29 +413,40 @@ Parser::~Parser() { delete lexer; }
 void Parser::advance()
 {
     previous = current;
+    if (exhausted)
+    {
+        current = Token(TokenType::END_OF_FILE, "EOF", previous.line);
+        return;
+    }
     for (;;)
     {
         current = lexer->scanToken();
         if (current.type != TokenType::ERROR) break;
-        errorAtCurrent(current.lexeme);
+        errorAtCurrent(String(current.lexeme, (int)current.length));
     }
 }
 
 
 bool Parser::compile()
 {
-    current_process =   vm->main_process;
-    current_function = current_process->function;
+    current_blueprint = vm->main_blueprint;
+    current_function = current_blueprint->function;
+    exhausted = false;
+    loop = nullptr;
+    finished = nullptr;
+    finishedCount = 0;
 
    // INFO("Parsing started");
 
-
-    advance();
-
-    while (!match(TokenType::END_OF_FILE))
+    if (openBlueprint(current_blueprint))
     {
+        advance();
 
-        declaration();
+        while (!match(TokenType::END_OF_FILE))
+        {
+
+            declaration();
+        }
     }
 
 
@@ -301,20 +454,115 @@ bool Parser::compile()
 
   //  INFO("Parsing done");
 
+    closeBlueprints();
+    arena.release();
     return !had_error;
 }
 
+void Parser::finishFunction(ObjFunction* function)
+{
+    FunctionList* node = arena.allocate<FunctionList>();
+    if (!node) return; // it stays unpacked, which is fine
+    node->function = function;
+    node->next = finished;
+    finished = node;
+    finishedCount++;
+}
+
+// Moves the code of every function this compile finished into one
+// read-only segment. Jumps are patched and stacks measured by now; nothing
+// writes to these chunks again.
+void Parser::packCode()
+{
+    if (finishedCount == 0) return;
+    Chunk** chunks = arena.allocate<Chunk*>(finishedCount);
+    if (!chunks) return;
+
+    u32 count = 0;
+    for (FunctionList* node = finished; node; node = node->next)
+    {
+        chunks[count++] = &node->function->chunk;
+    }
+    CodeSegment::pack(chunks, count);
+    finished = nullptr;
+    finishedCount = 0;
+}
+
+// Stops the compile: the rest of the source reads as end of file.
+void Parser::outOfMemory()
+{
+    if (exhausted) return;
+    error("Out of compiler memory.");
+    exhausted = true;
+}
 
-void Parser::beginScope() { current_process->scopeDepth++; }
+bool Parser::addJump(JumpList** list, int offset)
+{
+    JumpList* jump = arena.allocate<JumpList>();
+    if (!jump)
+    {
+        outOfMemory();
+        return false;
+    }
+    jump->offset = offset;
+    jump->next = *list;
+    *list = jump;
+    return true;
+}
+
+void Parser::patchJumps(JumpList* list)
+{
+    for (JumpList* jump = list; jump; jump = jump->next)
+    {
+        patchJump(jump->offset);
+    }
+}
+
+// The previous token's text, NUL-terminated, for names the VM keeps a
+// copy of (functions, processes, globals).
+const char* Parser::copyName()
+{
+    const char* name = arena.copy(previous.lexeme, previous.length);
+    if (!name) outOfMemory();
+    return name;
+}
+
+bool Parser::openBlueprint(ProcessBlueprint* blueprint)
+{
+    blueprint->locals = arena.allocate<Local>(ProcessBlueprint::UINT8_COUNT);
+    blueprint->localCount = 0;
+    blueprint->scopeDepth = 0;
+    if (!blueprint->locals)
+    {
+        outOfMemory();
+        return false;
+    }
+    return true;
+}
+
+// Locals point into the arena and the source; neither survives compile().
+void Parser::closeBlueprints()
+{
+    vm->main_blueprint->locals = nullptr;
+    vm->main_blueprint->localCount = 0;
+    for (u32 i = 0; i < vm->blueprints.getSize(); i++)
+    {
+        vm->blueprints[i]->locals = nullptr;
+        vm->blueprints[i]->localCount = 0;
+    }
+}
+
+
+void Parser::beginScope() { current_blueprint->scopeDepth++; }
 
 void Parser::endScope()
 {
-    current_process->scopeDepth--;
+    current_blueprint->scopeDepth--;
 
-    while (current_process->localCount > 0 && current_process->locals[current_process->localCount - 1].depth> current_process->scopeDepth && !current_process->locals[current_process->localCount - 1].isArg)
+    while (current_blueprint->localCount > 0 && current_blueprint->locals[current_blueprint->localCount - 1].depth> current_blueprint->scopeDepth && !current_blueprint->locals[current_blueprint->localCount - 1].isArg)
     {
         emitByte(OP_POP);
-        current_process->localCount--;
+        current_blueprint->localCount--;
     }
 }
 
@@ -443,12 +691,13 @@ void Parser::frameStatement()
 
 void Parser::variable(bool canAssign)
 {
-    String name = previous.lexeme;
+    const char* name = previous.lexeme;
+    u32 length = previous.length;
 
     u8 SET = OP_SET_GLOBAL;
     u8 GET = OP_GET_GLOBAL;
 
-    int arg = current_process->resolveLocal(name.c_str(), name.length());
+    int arg = current_blueprint->resolveLocal(name, length);
 
     if (arg != -1)
     {
@@ -456,9 +705,15 @@ void Parser::variable(bool canAssign)
         SET = OP_SET_LOCAL;
         GET = OP_GET_LOCAL;
     }
+    else if (current_function == current_blueprint->function &&
+             (arg = current_blueprint->resolveField(name, length)) != -1)
+    {
+        SET = OP_SET_FIELD;
+        GET = OP_GET_FIELD;
+    }
     else
     {
-        arg = vm->addConstant(STRING(name.c_str()));
+        arg = vm->addConstant(STRING(name, length));
     }
 
     if (canAssign && match(TokenType::EQUAL))
@@ -484,8 +739,8 @@ void Parser::ifStatement()
     emitByte(OP_POP); // Remove condition from stack
     statement();
     
-    Vector<int> endJumps; // Para saltar todos os elifs/else
-    endJumps.push_back(emitJump(OP_JUMP));
+    JumpList* endJumps = nullptr; // Para saltar todos os elifs/else
+    addJump(&endJumps, emitJump(OP_JUMP));
     
     // Handle elif chains
     while (match(TokenType::ELIF)) 
@@ -501,7 +756,7 @@ void Parser::ifStatement()
         emitByte(OP_POP); // Remove condition
         statement();
         
-        endJumps.push_back(emitJump(OP_JUMP));
+        addJump(&endJumps, emitJump(OP_JUMP));
     }
     
     // Handle final else
@@ -517,51 +772,60 @@ void Parser::ifStatement()
     }
     
     // Patch all end jumps
-    for (int jump : endJumps) 
-    {
-        patchJump(jump);
-    }
+    patchJumps(endJumps);
 }
 
 void Parser::breakStatement()
 {
-
-    
-
-    if (current_function->loopStack.empty()) 
+    if (!loop) 
     {
         error("Cannot use 'break' outside of loop");
         return;
     }
-    int jump = emitJump(OP_JUMP);
-    current_function->loopStack.back().breakJumps.push_back(jump);
+    popLoopLocals();
+    addJump(&loop->breakJumps, emitJump(OP_JUMP));
 
     consume(TokenType::SEMICOLON, "Expect ';' after 'break'");
-   
 }
 
 void Parser::continueStatement()
 {
-    if (current_function->loopStack.empty()) 
+    if (!loop) 
     {
         error("Cannot use 'continue' outside of loop");
         return;
     }
-    emitLoop(current_function->loopStack.back().loopStart);
+    popLoopLocals();
+    emitLoop(loop->loopStart);
     consume(TokenType::SEMICOLON, "Expect ';' after 'continue'");
-    
-   
 }
-void Parser::patchBreakJumps()
+
+// break and continue leave the body's scopes without going through
+// endScope(), so their locals are popped here. They stay declared: the
+// code after the jump still sees them.
+void Parser::popLoopLocals()
 {
-    const ValueArray<int> breakJumps = current_function->loopStack.back().breakJumps;
-    for (u32 i=0; i< breakJumps.getSize(); i++) 
+    for (int i = current_blueprint->localCount - 1; i >= 0; i--)
     {
-        patchJump(breakJumps[i]); 
+        const Local& local = current_blueprint->locals[i];
+        if (local.depth <= loop->scopeDepth || local.isArg) break;
+        emitByte(OP_POP);
     }
-    current_function->loopStack.pop_back();
+}
 
-    
+void Parser::beginLoop(LoopContext* context, int loopStart)
+{
+    context->loopStart = loopStart;
+    context->scopeDepth = current_blueprint->scopeDepth;
+    context->breakJumps = nullptr;
+    context->enclosing = loop;
+    loop = context;
+}
+
+void Parser::endLoop()
+{
+    patchJumps(loop->breakJumps);
+    loop = loop->enclosing;
 }
 
 void Parser::doStatement() 
@@ -572,9 +836,7 @@ void Parser::doStatement()
     int loopStart     = current_function->chunk.count;   
 
     LoopContext ctx;
-    ctx.loopStart = loopStart;
-    ctx.breakJumps.clear();
-    current_function->loopStack.push_back(ctx);
+    beginLoop(&ctx, loopStart);
 
     statement();
     
@@ -595,7 +857,7 @@ void Parser::doStatement()
     patchJump(exitJump);
     emitByte(OP_POP);
 
-    patchBreakJumps();
+    endLoop();
     
     
 
@@ -610,16 +872,14 @@ void Parser::loopStatement()
     int loopStart = current_function->chunk.count;
  
     LoopContext ctx;
-    ctx.loopStart = loopStart;
-    ctx.breakJumps.clear();
-    current_function->loopStack.push_back(ctx);
+    beginLoop(&ctx, loopStart);
 
     statement();
     emitLoop(loopStart);
     
      
 
-    patchBreakJumps();
+    endLoop();
  
 
  
@@ -634,10 +894,8 @@ void Parser::whileStatement()
   
     int loopStart = current_function->chunk.count;
 
-      LoopContext ctx;
-    ctx.loopStart = loopStart;
-    ctx.breakJumps.clear();
-    current_function->loopStack.push_back(ctx);
+    LoopContext ctx;
+    beginLoop(&ctx, loopStart);
     
     consume(TokenType::LEFT_PAREN, "Expect '(' after 'while'.");
     expression();
@@ -653,7 +911,7 @@ void Parser::whileStatement()
     patchJump(exitJump);
     emitByte(OP_POP); 
 
-    patchBreakJumps();
+    endLoop();
     
 
 
@@ -684,9 +942,7 @@ void Parser::forStatement()
 
     int loopStart = current_function->chunk.count;
     LoopContext ctx;
-    ctx.loopStart = loopStart;
-    ctx.breakJumps.clear();
-    current_function->loopStack.push_back(ctx);
+    beginLoop(&ctx, loopStart);
     int exitJump = -1;
 
     // Condition
@@ -712,7 +968,7 @@ void Parser::forStatement()
         emitLoop(loopStart);
         loopStart = incrementStart;
         patchJump(bodyJump);
-        current_function->loopStack.back().loopStart = loopStart;
+        loop->loopStart = loopStart;
     }
 
     // Body
@@ -724,7 +980,7 @@ void Parser::forStatement()
         emitByte(OP_POP); // Remove false condition
     }
 
-    patchBreakJumps();
+    endLoop();
  
     endScope();
 }
@@ -754,8 +1010,7 @@ void Parser::switchStatement()
     expression();
     consume(TokenType::RIGHT_PAREN, "Expect ')' after switch condition.");
     consume(TokenType::LEFT_BRACE, "Expect '{' before switch cases.");
-    Vector<int> endJumps;
-    endJumps.reserve(32);
+    JumpList* endJumps = nullptr;
     int caseCount = 0;
     while (match(TokenType::CASE))
     {
@@ -765,7 +1020,7 @@ void Parser::switchStatement()
         emitByte(OP_EQUAL);
         int caseJump = emitJump(OP_JUMP_IF_FALSE);
         statement();
-        endJumps.push_back(emitJump(OP_JUMP));
+        addJump(&endJumps, emitJump(OP_JUMP));
         patchJump(caseJump);
         emitByte(OP_POP); // Pop case value if false
         caseCount++;
@@ -782,10 +1037,7 @@ void Parser::switchStatement()
         error("Switch statement must have at least one case or a default case.");
         return;
     }
-    for (u32 i = 0; i < endJumps.size(); i++)
-    {
-        patchJump(endJumps[i]);
-    }
+    patchJumps(endJumps);
 }
 
 void Parser::call(bool canAssign) 
@@ -800,19 +1052,27 @@ void Parser::funDeclaration()
     consume(TokenType::IDENTIFIER, "Expect 'def' before function name.");
     
     
-    String name = previous.lexeme;
+    const char* name = copyName();
+    u32 length = previous.length;
     consume(TokenType::LEFT_PAREN, "Expect '(' after function name.");
+    if (!name) return;
     
-    // INFO("function name: %s", name.c_str());
+    // INFO("function name: %s", name);
     
     
-    u32 nameIndex = vm->addConstant(STRING(name.c_str()));
-
-    current_function = vm->add_function(name.c_str(), 0);
+    u32 nameIndex = vm->addConstant(STRING(name, length));
+
+    current_function = vm->add_function(name, 0);
+    // break/continue don't reach the loops around the declaration
+    LoopContext* enclosingLoop = loop;
+    loop = nullptr;
+    // The function's name and parameters are args, which endScope() keeps;
+    // drop them explicitly so later code doesn't resolve them as locals.
+    int enclosingLocals = current_blueprint->localCount;
     beginScope();
 
-    current_process->addLocal(name.c_str(), name.length(), true);
-    current_process->markInitialized();
+    current_blueprint->addLocal(name, length, true);
+    current_blueprint->markInitialized();
     
     if (!check(TokenType::RIGHT_PAREN))
     {
@@ -825,11 +1085,10 @@ void Parser::funDeclaration()
             }
             
             consume(TokenType::IDENTIFIER, "Expect parameter name.");
-            String paramName = previous.lexeme;
             
-            //INFO("parameter name: %s", paramName.c_str());
-            current_process->addLocal(paramName.c_str(), paramName.length(), true);
-            current_process->markInitialized();
+            //INFO("parameter name: %.*s", (int)previous.length, previous.lexeme);
+            current_blueprint->addLocal(previous.lexeme, previous.length, true);
+            current_blueprint->markInitialized();
             
       
             
@@ -845,18 +1104,23 @@ void Parser::funDeclaration()
     
     block();
     endScope();
+    current_blueprint->localCount = enclosingLocals;
     
     if (!call_return)
     {
         emitByte(OP_NIL);
         emitByte(OP_RETURN);
     }
+
+    current_function->maxStack = measureStack(current_function, 1 + current_function->arity);
+    finishFunction(current_function);
     
 
    
     int functionIndex = vm->addConstant(FUNCTION(current_function));
-    //int functionIndex =current_process->addConstant(STRING(name.c_str()));
+    //int functionIndex =current_blueprint->addConstant(STRING(name.c_str()));
     current_function = prefunction;
+    loop = enclosingLoop;
     
     emitBytes(OP_CONSTANT,    functionIndex);
     emitBytes(OP_DEFINE_GLOBAL, nameIndex);
@@ -866,7 +1130,7 @@ void Parser::funDeclaration()
 
 void Parser::procDeclaration() 
 {
-    Process* preProcess = current_process;
+    ProcessBlueprint* preBlueprint = current_blueprint;
     
     ObjFunction* prefunction = current_function;
 
@@ -876,25 +1140,33 @@ void Parser::procDeclaration()
     consume(TokenType::IDENTIFIER, "Expect 'process' before process name.");
     
     
-    String name = previous.lexeme;
+    const char* name = copyName();
+    u32 length = previous.length;
     consume(TokenType::LEFT_PAREN, "Expect '(' after process name.");
+    if (!name) return;
     
     
-    u32 nameIndex = vm->addConstant(STRING(name.c_str()));
-    current_process = vm->create_process(name.c_str());
-    current_function = current_process->function;
-    current_process->addLocal("x");
-    current_process->addLocal("y");
-    current_process->addLocal("angle");
+    u32 nameIndex = vm->addConstant(STRING(name, length));
+    current_blueprint = vm->create_blueprint(name);
+    current_function = current_blueprint->function;
+    current_blueprint->defineFields();
+    if (!openBlueprint(current_blueprint))
+    {
+        current_blueprint = preBlueprint;
+        current_function = prefunction;
+        return;
+    }
+    LoopContext* enclosingLoop = loop;
+    loop = nullptr;
 
    beginScope();
 
 
-    // current_process->addLocal("y", 1, true);
-    // current_process->markInitialized();
+    // current_blueprint->addLocal("y", 1, true);
+    // current_blueprint->markInitialized();
     
-    // current_process->addLocal(name.c_str(), name.length(), true);
-    // current_process->markInitialized();
+    // current_blueprint->addLocal(name.c_str(), name.length(), true);
+    // current_blueprint->markInitialized();
     // u32 index = vm->addConstant(STRING(name.c_str()));
     // emitBytes(OP_DEFINE_LOCAL, index); 
     if (!check(TokenType::RIGHT_PAREN))
@@ -908,10 +1180,10 @@ void Parser::procDeclaration()
             }
             
             consume(TokenType::IDENTIFIER, "Expect parameter name.");
-            String paramName = previous.lexeme;
-            //current_process->addLocal(paramName.c_str(), paramName.length(), true);
-            //current_process->markInitialized();
-            current_process->addLocal(paramName.c_str());
+            //current_blueprint->addLocal(paramName.c_str(), paramName.length(), true);
+            //current_blueprint->markInitialized();
+            const char* paramName = copyName();
+            if (paramName) current_blueprint->addLocal(paramName);
             //    u32 index = vm->addConstant(STRING(paramName.c_str()));
             //   emitBytes(OP_SET_LOCAL, index); 
         } while (match(TokenType::COMMA));
@@ -952,14 +1224,19 @@ void Parser::procDeclaration()
     
     emitByte(OP_HALT);
     
-    ObjProcess* process= vm->add_raw_process(name.c_str());
-    process->process  = current_process;
+    current_function->maxStack = measureStack(current_function, current_blueprint->arity());
+    finishFunction(current_function);
+    current_blueprint->maxStack = current_function->maxStack;
+
+    ObjProcess* process= vm->add_raw_process(name);
+    process->blueprint  = current_blueprint;
     process->function = current_function;
     
     //  process->process->disassembleCode(&process->function->chunk, "process");
    
-    current_process  = preProcess;
+    current_blueprint  = preBlueprint;
     current_function = prefunction;
+    loop = enclosingLoop;
     int functionIndex = vm->addConstant(PROCESS(process));
 
     
@@ -1010,9 +1287,8 @@ void Parser::returnStatement()
 void Parser::varProcessDeclaration()
 {
    consume(TokenType::IDENTIFIER, "Expect variable name.");
-    String name = previous.lexeme;
-    current_process->addLocal(name.c_str(), name.length(), false);
-    current_process->markInitialized();
+    current_blueprint->addLocal(previous.lexeme, previous.length, false);
+    current_blueprint->markInitialized();
     if (match(TokenType::EQUAL))
     {
         expression();
@@ -1029,11 +1305,12 @@ void Parser::varProcessDeclaration()
 void Parser::varDeclaration()
 {
     consume(TokenType::IDENTIFIER, "Expect variable name.");
-    String name = previous.lexeme;
-    if (current_process->scopeDepth > 0)
+    const char* name = previous.lexeme;
+    u32 length = previous.length;
+    if (current_blueprint->scopeDepth > 0)
     {
 
-        current_process->addLocal(name.c_str(), name.length(), false);
+        current_blueprint->addLocal(name, length, false);
 
         if (match(TokenType::EQUAL))
         {
@@ -1045,13 +1322,13 @@ void Parser::varDeclaration()
 
         }
 
-        current_process->markInitialized();
+        current_blueprint->markInitialized();
         consume(TokenType::SEMICOLON, "Expect ';' after variable declaration.");
         return;
     }
 
 
-    u32 index = vm->addConstant(STRING(name.c_str()));
+    u32 index = vm->addConstant(STRING(name, length));
 
     if (match(TokenType::EQUAL))
     {
@@ -1087,7 +1364,7 @@ void Parser::grouping(bool canAssign)
 
 void Parser::number(bool canAssign)
 {
-    Value value = NUMBER(std::stod(previous.lexeme.c_str()));
+    Value value = NUMBER(previous.number);
 
     emitConstant(std::move((value)));
 }
@@ -1095,7 +1372,7 @@ void Parser::number(bool canAssign)
 void Parser::string(bool canAssign)
 {
 
-    Value value = STRING(previous.lexeme.c_str());
+    Value value = STRING(previous.lexeme, previous.length);
     emitConstant(std::move(value));
 }
 void Parser::literal(bool canAssign) 
@@ -1117,6 +1394,25 @@ void Parser::binary(bool canAssign)
     ParseRule* rule = getRule(operatorType);
     parsePrecedence((Precedence)(rule->precedence + 1));
 
+    // a + b + c ... becomes one OP_CONCAT, so "Score: " + s + " Lives: " + l
+    // builds its text once instead of a string per '+'.
+    if (operatorType == TokenType::PLUS && check(TokenType::PLUS))
+    {
+        u32 count = 2;
+        while (match(TokenType::PLUS))
+        {
+            if (count == 255)
+            {
+                emitBytes(OP_CONCAT, (u8)count);
+                count = 1;
+            }
+            parsePrecedence((Precedence)(rule->precedence + 1));
+            count++;
+        }
+        emitBytes(OP_CONCAT, (u8)count);
+        return;
+    }
+
     switch (operatorType)
     {
         case TokenType::PLUS: emitByte(OP_ADD); break;
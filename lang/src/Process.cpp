@@ -1,58 +1,228 @@
 #include "VM.hpp"
 #include "Utils.hpp"
+extern GarbageCollector GC;
 
 
-u32 Process::nextPID = 1;
+u32 Process::nextSerial = 1;
 
 
 
 
  
 
-Process::Process(    Interpreter* interpreter,bool isRoot)
+Process::Process(Interpreter* interpreter, ProcessBlueprint* blueprint, bool isRoot)
 {
     this->interpreter = interpreter;
-    size_t len = strlen("Process");
-    strncpy(name, "Process", len);
+    this->blueprint = blueprint;
+    const char* src = blueprint ? blueprint->name : "Process";
+    size_t len = strlen(src);
+    if (len > sizeof(name) - 1) len = sizeof(name) - 1;
+    memcpy(name, src, len);
     name[len] = '\0';
-    id = nextPID++;
+    id = interpreter->handles.acquire(this);
+    serial = nextSerial++;
     priority = 0;
     status = STATUS_RUNNING;
     frame_percent = 0;
+    preemptions = 0;
+    budget = 0;
+    preempted = false;
+    deferred = false;
     saved_status = status;
  
     next = nullptr;
     prev = nullptr;
     frameCount = 0;
-    localCount = 0;
-    scopeDepth = 0;
     defineLocals = 0;
-    stackTop = &stack[0];
-    function = nullptr;
-    frame_timer = 0.0;     
-    frame_interval = 1.0/60.0; 
+    function = blueprint ? blueprint->function : nullptr;
+    sched.owner = this;
+    wake_time = 0;
+    queued = false;
+    field = FieldStore::NO_ROW;
+    instanceLink.owner = this;
+    siblingLink.owner = this;
+    father = nullptr;
+    if (blueprint)
+    {
+        blueprint->instances.push_back(&instanceLink);
+        blueprint->instanceCount++;
+    }
     frame_speed_multiplier = 1.0; 
     root = isRoot;
-    if (isRoot)
+
+    // Root processes also serve the host push/pop API, so they keep the old
+    // fixed size; spawned instances get exactly what the blueprint measured.
+    stackCapacity = isRoot ? STACK_MAX : 0;
+    if (blueprint && blueprint->maxStack > stackCapacity)
     {
-        function = new ObjFunction("__main__");
+        stackCapacity = blueprint->maxStack;
     }
+    if (stackCapacity == 0) stackCapacity = 1;
+    stack = (Value*) std::malloc(stackCapacity * sizeof(Value));
+    stackTop = stack;
 
+    frameCapacity = isRoot ? FRAMES_MAX : 1;
+    frames = (CallFrame*) std::malloc(frameCapacity * sizeof(CallFrame));
+    currentFrame = frames;
+
+    Memory.allocate(MEMORY_PROCESSES, sizeof(Process));
+    Memory.allocate(MEMORY_STACKS, stackCapacity * sizeof(Value) + frameCapacity * sizeof(CallFrame), 2);
 }
 
 Process::~Process()
 {
   //  INFO("deleting process: %s", name);
- 
-    if (function != nullptr && root) 
+    sched.unlink();
+    leaveBlueprint();
+    leaveFamily();
+    if (field != FieldStore::NO_ROW)
     {
-        delete function;
-        function = nullptr;
+        interpreter->fields.remove(field);
+    }
+    interpreter->handles.release(id);
+    std::free(stack);
+    std::free(frames);
+
+    Memory.release(MEMORY_PROCESSES, sizeof(Process));
+    Memory.release(MEMORY_STACKS, stackCapacity * sizeof(Value) + frameCapacity * sizeof(CallFrame), 2);
+}
+
+bool Process::growStack(u32 needed)
+{
+    if (needed <= stackCapacity) return true;
+
+    u32 capacity = stackCapacity * 2;
+    if (capacity < needed) capacity = needed;
+
+    Value* newStack = (Value*) std::realloc(stack, capacity * sizeof(Value));
+    if (!newStack)
+    {
+        DEBUG_BREAK_IF(newStack == nullptr);
+        return false;
     }
-    
 
+    // Frames point into the old block; rebase them.
+    for (int i = 0; i < frameCount; i++)
+    {
+        frames[i].slots = newStack + (frames[i].slots - stack);
+    }
+    stackTop = newStack + (stackTop - stack);
+    stack = newStack;
+    Memory.resize(MEMORY_STACKS, stackCapacity * sizeof(Value), capacity * sizeof(Value));
+    stackCapacity = capacity;
+    return true;
+}
 
+bool Process::growFrames()
+{
+    if (frameCapacity >= FRAMES_MAX) return false;
 
+    int capacity = frameCapacity * 2;
+    if (capacity > FRAMES_MAX) capacity = FRAMES_MAX;
+
+    CallFrame* newFrames = (CallFrame*) std::realloc(frames, capacity * sizeof(CallFrame));
+    if (!newFrames)
+    {
+        DEBUG_BREAK_IF(newFrames == nullptr);
+        return false;
+    }
+    currentFrame = newFrames + (currentFrame - frames);
+    frames = newFrames;
+    Memory.resize(MEMORY_STACKS, frameCapacity * sizeof(CallFrame), capacity * sizeof(CallFrame));
+    frameCapacity = capacity;
+    return true;
+}
+
+
+// Text of the string concatenate() is building. One per thread, since
+// workers run processes side by side; it keeps its capacity, so steady
+// UI text costs no allocation but the result.
+struct TextBuilder
+{
+    char* data = nullptr;
+    size_t length = 0;
+    size_t capacity = 0;
+
+    ~TextBuilder() { std::free(data); }
+
+    bool append(const char* text, size_t count)
+    {
+        if (length + count + 1 > capacity)
+        {
+            size_t size = capacity < 256 ? 256 : capacity;
+            while (size < length + count + 1) size *= 2;
+            char* block = (char*) std::realloc(data, size);
+            if (!block) return false;
+            data = block;
+            capacity = size;
+        }
+        memcpy(data + length, text, count);
+        length += count;
+        return true;
+    }
+};
+
+static thread_local TextBuilder builder;
+
+// Replaces the top count values with a + b + c ..., added left to right
+// like a chain of OP_ADD: numbers sum until the first string, from there
+// on everything is joined as text, numbers formatted. The result is a
+// single new string, however many parts.
+bool Process::concatenate(u32 count)
+{
+    Value* parts = stackTop - count;
+    u32 i = 0;
+    bool numeric = parts[0].type == ValueType::NUMBER;
+    double sum = 0;
+    if (numeric)
+    {
+        sum = parts[0].number;
+        for (i = 1; i < count && parts[i].type == ValueType::NUMBER; i++)
+        {
+            sum += parts[i].number;
+        }
+        if (i == count)
+        {
+            stackTop = parts;
+            push(NUMBER(sum));
+            return true;
+        }
+    }
+
+    char number[NUMBER_BUFFER_SIZE];
+    builder.length = 0;
+    bool ok = true;
+    if (numeric)
+    {
+        ok = builder.append(number, formatNumber(sum, number));
+    }
+    for (; ok && i < count; i++)
+    {
+        const Value& part = parts[i];
+        if (part.type == ValueType::STRING)
+        {
+            ok = builder.append(part.string->data, (size_t)part.string->length);
+        }
+        else if (part.type == ValueType::NUMBER)
+        {
+            ok = builder.append(number, formatNumber(part.number, number));
+        }
+        else
+        {
+            PRINT_VALUE(part);
+            runtimeError("Operation 'add' not supported.");
+            return false;
+        }
+    }
+    if (!ok || builder.length > INT32_MAX)
+    {
+        runtimeError("String too long.");
+        return false;
+    }
+
+    stackTop = parts;
+    push(STRING(builder.data, builder.length));
+    return true;
 }
 
 void Process::printStack() const
@@ -82,107 +252,127 @@ void Process::printStack() const
 void Process::setFrameSpeed(double speed_multiplier)
 {
     // speed_multiplier: 1.0 = normal, 2.0 = duplo, 0.5 = metade
+    // Scales the cost of every following frame(n).
+    if (speed_multiplier <= 0.0) speed_multiplier = 0.001;
     frame_speed_multiplier = speed_multiplier;
-    
-    // Recalcular intervalo baseado na velocidade atual
-    double base_fps = 60.0;
-    double adjusted_fps = base_fps * speed_multiplier;
-    frame_interval = 1.0 / adjusted_fps;
 }
 
  
 void Process::pauseForSeconds(double seconds)
 {
-    frame_timer = -seconds; // Timer negativo = pausa
+    wake_time = interpreter->clock + (u64)(seconds * 1000000.0);
+    if (interpreter->running_process != this && status == STATUS_RUNNING)
+    {
+        interpreter->schedule(this);
+    }
 }
 
 
-int Process::addLocal(const char* name) 
+void Process::setStatus(ProcessStatus status)
 {
-   
-    if (localCount >= UINT8_COUNT)
+    this->status = status;
+    if (field != FieldStore::NO_ROW)
     {
-        runtimeError("Too many local variables in function.");
-        return -1;
+        interpreter->fields.status[field] = (u8)status;
     }
-    
-     
-    Local *local = &locals[localCount++];
-    
-    local->len = strlen(name);
-    strncpy(local->name, name, local->len);
-    local->name[local->len] = '\0';
-    local->isArg = true;
-    local->depth = 0;
-
-
+    // On a worker thread the shared lists are left alone; the interpreter
+    // unhooks the process once the parallel batch is over.
+    if ((status == STATUS_DEAD || status == STATUS_KILLED) && !interpreter->parallel_phase)
+    {
+        leaveBlueprint();
+        leaveFamily();
+    }
+}
 
-    
-    return localCount - 1;
+void Process::bufferGlobal(ObjString* name, const Value& value)
+{
+    for (u32 i = 0; i < pendingGlobals.size(); i++)
+    {
+        if (pendingGlobals[i].name == name)
+        {
+            pendingGlobals[i].value = value;
+            return;
+        }
+    }
+    PendingGlobal pending;
+    pending.name = name;
+    pending.value = value;
+    pendingGlobals.push_back(pending);
 }
 
-int Process::addLocal(const char* name,size_t len, bool isArg) 
+bool Process::findPendingGlobal(ObjString* name, Value* value) const
 {
-    if (localCount >= UINT8_COUNT)
+    for (u32 i = 0; i < pendingGlobals.size(); i++)
     {
-        runtimeError("Too many local variables in function.");
-        return -1;
+        if (pendingGlobals[i].name == name)
+        {
+            *value = pendingGlobals[i].value;
+            return true;
+        }
     }
-    
-     
-    Local *local = &locals[localCount++];
-    
-    strncpy(local->name, name, len);
-    local->name[len] = '\0';
-    local->len = len;
-    local->isArg = isArg;
-    local->depth = -1;
-    
-    return localCount - 1;
+    return false;
 }
 
-static bool identifiersEqual(const char* a,size_t aLen, const char* b, size_t bLen)
+// Dead processes drop out of their type's instance list right away, so
+// counts and broadcasts never see them during the rest of the tick.
+void Process::adopt(Process* child)
 {
-    if (aLen != bLen) return false;   
-    return memcmp(a, b, aLen) == 0;
+    child->father = this;
+    children.push_back(&child->siblingLink);
 }
 
-int Process::resolveLocal(const char* name,size_t len)
+// Unhooks a dying process from its father. Its children become orphans
+// (father == nullptr) and keep running, as in DIV.
+void Process::leaveFamily()
 {
-    
-    for (int i = localCount - 1; i >= 0; i--) 
+    siblingLink.unlink();
+    father = nullptr;
+    while (Process* child = children.pop_front())
     {
-        Local* local = &locals[i];
-        if (identifiersEqual(local->name, local->len, name, len)) 
-        {
-            if (local->depth == -1) 
-            {
-                runtimeError("Can't read local variable in its own initializer.");
-                return -1;
-            }
-        return i;
-        }
-  }
-
-  return -1;
+        child->father = nullptr;
+    }
 }
 
-void Process::markInitialized() 
+void Process::leaveBlueprint()
 {
-      if (scopeDepth == 0) return;
-      locals[localCount - 1].depth = scopeDepth;
+    if (!instanceLink.linked()) return;
+    instanceLink.unlink();
+    blueprint->instanceCount--;
 }
 
-void Process::init_locals() 
+// Builds the first frame of a freshly spawned instance: a FieldStore row
+// seeded with the blueprint's field defaults, then the arguments.
+void Process::start(const Value* args, int argCount)
 {
-    
-    // addLocal("x", 4, false);
-    // addLocal("y", 4, false);
-    // addLocal("angle", 6, false);
-    push(std::move(NUMBER(30)));//angle
-    push(std::move(NUMBER(2)));//y
-    push(std::move(NUMBER(360)));//x
-    // markInitialized();
+    CallFrame* frame = &frames[frameCount++];
+    frame->function = blueprint->function;
+    frame->ip = blueprint->function->chunk.code;
+    frame->slots = stack;
+    currentFrame = frame;
+
+    // Without a row (out of memory) the process still runs; its first
+    // field access stops it with a runtime error.
+    if (blueprint->fieldCount > 0)
+    {
+        field = interpreter->fields.add(this, blueprint->fields);
+    }
+    std::memcpy(stack, args, argCount * sizeof(Value));
+    stackTop = stack + argCount;
+    // The child may not run before the nursery is dropped.
+    for (Value* slot = stack; slot < stackTop; slot++)
+    {
+        GC.promote(slot);
+    }
+    defineLocals = argCount;
+
+    if (interpreter->trace_level >= TRACE_SPAWN)
+    {
+        INFO("Process '%s' (%u) spawned", name, id);
+    }
+    if (interpreter->trace_level >= TRACE_CODE)
+    {
+        disassembleCode(&blueprint->function->chunk, name);
+    }
 }
 
 void Process::resetStack()
@@ -191,8 +381,15 @@ void Process::resetStack()
     frameCount = 0;
 }
 
+    // Compiled code never goes past the measured depth; should that measure
+    // ever be short, the stack grows rather than being written past.
     void Process::push(Value value)
     {
+        if (stackTop >= stack + stackCapacity && !growStack(stackCapacity + 1))
+        {
+            ERROR("Stack overflow in process '%s'", name);
+            std::exit(EXIT_FAILURE);
+        }
         *stackTop = value;
         stackTop++;
     }
@@ -242,12 +439,21 @@ bool Process::should_execute() const
             return false;
         }
 
-        if (frameCount == FRAMES_MAX)
+        if (frameCount == frameCapacity && !growFrames())
         {
             runtimeError("Call Stack overflow.");
             return false;
         }
 
+        // Callee slot + arguments are already on the stack.
+        s32 base = static_cast<s32>(stackTop - stack) - argCount - 1;
+        if (base < 0) base = 0;
+        if (!growStack(base + function->maxStack))
+        {
+            runtimeError("Stack overflow.");
+            return false;
+        }
+
         CallFrame* frame = &frames[frameCount++];
         currentFrame = frame;
         frame->function = function;
@@ -259,24 +465,18 @@ bool Process::should_execute() const
 
 
 
- void Process::writeChunk(u8 instruction, int line) 
- {
-    function->chunk.write(instruction, line);
- }
-
  void Process::runtimeError(const String& message)
  {
          ERROR("Runtime error: %s", message.c_str());
 
-        // for (int i = frameCount - 1; i >= 0; i--)
-        // {
-        //     CallFrame* frame = &frames[i];
-        //     ObjFunction* function = frame->function;
-        //     size_t instruction = frame->ip - function->chunk.code - 1;
-        //     ERROR("[line %d] in %s()", function->chunk.lines[instruction], function->name);   
-            
-            
-        // }
+        for (int i = frameCount - 1; i >= 0; i--)
+        {
+            CallFrame* frame = &frames[i];
+            ObjFunction* function = frame->function;
+            if (!function || frame->ip <= function->chunk.code) continue;
+            u32 instruction = (u32)(frame->ip - function->chunk.code - 1);
+            ERROR("[line %d] in %s()", function->chunk.lineAt(instruction), function->name);
+        }
 
          resetStack();
 }
@@ -334,13 +534,14 @@ u32 Process::constantInstruction(Chunk* chunk,const char *name, u32 offset)
 u32 Process::disassembleInstruction(Chunk* chunk, u32 offset) 
 { 
      printf("%04d ", offset);
-    if (offset > 0 && chunk->lines[offset] == chunk->lines[offset - 1])
+    int line = chunk->lineAt(offset);
+    if (offset > 0 && line == chunk->lineAt(offset - 1))
     {
         printf("   | ");
     }
     else
     {
-        printf("%4d ", chunk->lines[offset]);
+        printf("%4d ", line);
     }
     u8 instruction = chunk->code[offset];
 
@@ -396,6 +597,10 @@ u32 Process::disassembleInstruction(Chunk* chunk, u32 offset)
                 
                 return simpleInstruction(chunk, "ADD", offset);
             }
+            case OP_CONCAT:
+            {
+                return byteInstruction(chunk, "CONCAT", offset);
+            }
             case OP_SUBTRACT:
             {
                 
@@ -451,6 +656,14 @@ u32 Process::disassembleInstruction(Chunk* chunk, u32 offset)
             {
                 return byteInstruction(chunk, "SET_LOCAL", offset);
             }
+            case OP_GET_FIELD:
+            {
+                return byteInstruction(chunk, "GET_FIELD", offset);
+            }
+            case OP_SET_FIELD:
+            {
+                return byteInstruction(chunk, "SET_FIELD", offset);
+            }
             case OP_DEFINE_LOCAL:
             {
                    return constantInstruction(chunk, "DEFINE_LOCAL", offset);
@@ -497,10 +710,17 @@ bool Process::run( )
     if (frameCount < 1)
     {
         runtimeError("Empty frames.");
-        status = STATUS_DEAD;
+        setStatus(STATUS_DEAD);
         return false;
     }
 
+    // First run makes the row visible to render passes.
+    if (field != FieldStore::NO_ROW)
+    {
+        interpreter->fields.status[field] = (u8)status;
+    }
+
+   const u32 trace = interpreter->trace_level;
 
    for (;;) 
     {
@@ -509,7 +729,7 @@ bool Process::run( )
     currentFrame = frame;
     if (frame->ip >= frame->function->chunk.code + frame->function->chunk.count)
     {
-        status = STATUS_RUNNING;
+        setStatus(STATUS_RUNNING);
         return false;
     } 
     
@@ -517,11 +737,7 @@ bool Process::run( )
     #define READ_SHORT() (frame->ip += 2,(uint16_t)((frame->ip[-2] << 8) | frame->ip[-1]))
     #define READ_CONSTANT() (interpreter->constants[READ_BYTE()])
 
-    const bool debug = false;
-
-
-
-    if (debug)
+    if (trace >= TRACE_STACK)
     {
         printf("          \n");
         for (Value* slot = stack; slot < stackTop; slot++)
@@ -571,7 +787,7 @@ bool Process::run( )
             case OP_HALT:
             {
                // WARNING("Process '%s' exited", name);
-                status = STATUS_DEAD;
+                setStatus(STATUS_DEAD);
                 return false;
             }
             case OP_XOR:
@@ -589,8 +805,8 @@ bool Process::run( )
                 if (frameCount == 0)
                 {
                     pop();
-                    INFO("Process '%s' finished", name);
-                    status = STATUS_DEAD;
+                    if (trace >= TRACE_SPAWN) INFO("Process '%s' finished", name);
+                    setStatus(STATUS_DEAD);
                     return false;
                 }
                // WARNING("Process '%s' function returned", name);
@@ -603,7 +819,12 @@ bool Process::run( )
             }
             case OP_PRINT:
             {
-                
+                if (interpreter->parallel_phase)
+                {
+                    frame->ip--; // output order must not depend on threads
+                    deferred = true;
+                    return true;
+                }
                 Value value = pop();
                 PRINT_VALUE(value);
 
@@ -633,6 +854,16 @@ bool Process::run( )
                 int argCount = READ_BYTE();
                 Value value= peek(argCount);
 
+                // Spawns and natives that are not thread-safe touch shared
+                // state; on a worker, stop here and redo the call serially.
+                if (interpreter->parallel_phase &&
+                    (IS_PROCESS(value) || (IS_NATIVE(value) && !AS_NATIVE(value)->threadSafe)))
+                {
+                    frame->ip -= 2;
+                    deferred = true;
+                    return true;
+                }
+
                // value.print();
      
 
@@ -649,18 +880,27 @@ bool Process::run( )
                     if (!call(function, argCount))
                     {
 
-                        status = STATUS_DEAD;
+                        setStatus(STATUS_DEAD);
                         return false;
                     }
 
+                    budget -= CALL_COST;
+                    if (budget <= 0)
+                    {
+                        preempted = true; // resumes inside the callee
+                        return true;
+                    }
+
            
                 }
                 else if (IS_NATIVE(value))
                 {
                         
                         ObjNative *obj_native = AS_NATIVE(value);
-                        NativeFn native = obj_native->function;
-                        Value result = native(argCount, stackTop - argCount);
+                        Value result = obj_native->function
+                            ? obj_native->function(argCount, stackTop - argCount)
+                            : obj_native->processFunction(this, argCount, stackTop - argCount);
+                        if (frameCount == 0) return false; // the native raised a runtime error
                         stackTop -= argCount + 1;
                         push(result);
 
@@ -672,41 +912,22 @@ bool Process::run( )
                 else if (IS_PROCESS(value))
                 {
                     ObjProcess* process = AS_PROCESS(value);
-                    
-                  //  INFO("Process '%s' called", process->name);
-
-                    Process* child = interpreter->queue_process(process->name,  100);
-                    
-              
- 
-
-
-
-                    CallFrame* cframe = &child->frames[child->frameCount++];
-                    child->defineLocals= argCount;
-                    cframe->function =  process->process->function;
-                    cframe->ip = process->function->chunk.code;
-                    cframe->slots = child->stackTop;
-                    child->init_locals();
-                    for (int i = argCount-1; i >= 0; i--)
+                    ProcessBlueprint* blueprint = process->blueprint;
+                    if (argCount != blueprint->arity())
                     {
-                        Value arg = peek(i);
-                        child->push(arg);
+                        ERROR("In call process '%s' expected %d arguments, got %d.", blueprint->name, blueprint->arity(), argCount);
+                        runtimeError("In Call process");
+                        return false;
                     }
-                   // pop();//???
-                   // pop();
-                    popn(argCount);
-             
-                    //frame->slots = stackTop - argCount - 1;
-                    
-                
-                    
-                   // printStack();
-                    
 
-                 disassembleCode(&process->process->function->chunk, process->name);
-       
-                   return true;
+                    // Children start at priority 0 whatever the parent's,
+                    // so they run after it in spawn order until they change it.
+                    Process* child = interpreter->queue_process(blueprint, 0);
+                    adopt(child);
+                    child->start(stackTop - argCount, argCount);
+                    popn(argCount);
+                    stackTop[-1] = NUMBER(child->id); // spawn evaluates to the child's id
+                    break;
                 }
  
     
@@ -723,24 +944,20 @@ bool Process::run( )
 
        
                  Value frameValue = pop();
-                double frame_param = AS_NUMBER(frameValue);
-                
-                // Interpretar o parâmetro frame():
-                // frame(100) = velocidade normal (60fps)
-                // frame(50)  = metade da velocidade (30fps)  
-                // frame(200) = velocidade dupla (120fps)
-                // frame(1)   = muito lento (0.6fps)
-      
-                double base_fps = 60.0;  
-                double target_fps = (frame_param / 100.0) * base_fps;
+                double frame_param = AS_NUMBER(frameValue) * frame_speed_multiplier;
                 
-      
-                if (target_fps <= 0.0) target_fps = 0.1;
+                // frame(n) runs the process at n% of the tick rate, DIV style
+                // accounting: each frame costs 100*100/n percent and the
+                // process keeps running in a tick until it has spent 100.
+                // frame(100) = once per tick
+                // frame(200) = twice per tick
+                // frame(50)  = every other tick
+                s32 cost = 10000;
+                if (frame_param >= 10000.0) cost = 1;
+                else if (frame_param > 1.0) cost = (s32)(10000.0 / frame_param + 0.5);
+                frame_percent += cost;
                 
-                frame_interval = 1.0 / target_fps;
-                frame_timer = 0.0; // Reset timer
-                
-                status = STATUS_RUNNING;
+                setStatus(STATUS_RUNNING);
                 //goto break_all;
 
                 return true; 
@@ -754,59 +971,17 @@ bool Process::run( )
                     Value a = pop();
                     push(NUMBER(a.number + b.number));
                 }
-                else if (peek(0).type == ValueType::STRING && peek(1).type == ValueType::STRING)
+                else if (!concatenate(2))
                 {
-                    Value b = pop();
-                    Value a = pop();
-                    const char* textA = a.string->data;
-                    const char* textB = b.string->data;
-
-                    int length = snprintf(nullptr, 0, "%s%s", textA, textB);
-                    if (length > 255)
-                    {
-                        runtimeError("String too long.");
-                        return false;
-                    }
-                    char text[256];
-                    snprintf(text, length + 1, "%s%s", textA, textB);
-                    text[length] = '\0';
-                    push(STRING(text));
-                } else if (peek(0).type == ValueType::STRING && peek(1).type == ValueType::NUMBER)
-                {
-                
-                    Value b = pop();
-                    pop();
-                    const char* textA = b.string->data;
-                    
-                    char text[256];
-                    int length = snprintf(text, sizeof(text), "%s%d", textA, (int)b.number);
-                    
-                    if (length < 256) 
-                    {
-                        push(STRING(text));
-                    } else 
-                    {
-                        char* dynText = (char*)malloc(length + 1);
-                        if (!dynText) 
-                        {
-                            runtimeError("Memory allocation failed.");
-                            return false;
-                        }
-                        snprintf(dynText, length + 1, "%s%d", textA, (int)b.number);
-                        push(STRING(dynText));
-                        free(dynText);
-                    }
-                }
-
-                else
-                {
-                    PRINT_VALUE(peek(0));
-                    PRINT_VALUE(peek(1));
-                    runtimeError("Operation 'add' not supported.");
                     return false;
                 }
                 break;
             }
+            case OP_CONCAT:
+            {
+                if (!concatenate(READ_BYTE())) return false;
+                break;
+            }
             case OP_SUBTRACT:
             {
                 if (peek(0).type == ValueType::NUMBER && peek(1).type == ValueType::NUMBER)
@@ -941,7 +1116,12 @@ bool Process::run( )
                     return false;
                 }
                 Value value = peek(0);
-                if (interpreter->define(AS_STRING(name)->data, std::move(value)))
+                if (interpreter->parallel_phase)
+                {
+                    bufferGlobal(AS_STRING(name), value);
+                    pop();
+                }
+                else if (interpreter->define(AS_STRING(name), std::move(value)))
                 {
                    // INFO("Variable '%s' defined.", AS_STRING(name)->data);
                     pop();
@@ -956,10 +1136,14 @@ bool Process::run( )
                     runtimeError("Variable name must be a string.");
                     return false;
                 }
-                if (interpreter->contains(AS_STRING(name)->data))
+                Value pending;
+                if (!pendingGlobals.empty() && findPendingGlobal(AS_STRING(name), &pending))
+                {
+                    push(pending);
+                }
+                else if (Value* global = interpreter->find_global(AS_STRING(name)))
                 {
-                    Value value =interpreter->get(AS_STRING(name)->data);
-                    push(value);
+                    push(*global);
                 }
                 else
                 {
@@ -977,7 +1161,10 @@ bool Process::run( )
                     runtimeError("Variable name must be a string.");
                     return false;
                 }
-                 interpreter->define(AS_STRING(name)->data, peek(0));
+                 if (interpreter->parallel_phase)
+                     bufferGlobal(AS_STRING(name), peek(0));
+                 else
+                     interpreter->define(AS_STRING(name), peek(0));
                  break;
             }
             case OP_GET_LOCAL:
@@ -1001,6 +1188,34 @@ bool Process::run( )
      
                 break;
             }
+            case OP_GET_FIELD:
+            {
+                u8 column = READ_BYTE();
+                if (field == FieldStore::NO_ROW)
+                {
+                    runtimeError("Process has no fields (out of memory when spawned).");
+                    return false;
+                }
+                push(NUMBER(interpreter->fields.columns[column][field]));
+                break;
+            }
+            case OP_SET_FIELD:
+            {
+                u8 column = READ_BYTE();
+                Value value = peek(0);
+                if (!IS_NUMBER(value))
+                {
+                    runtimeError("Built-in fields must be numbers.");
+                    return false;
+                }
+                if (field == FieldStore::NO_ROW)
+                {
+                    runtimeError("Process has no fields (out of memory when spawned).");
+                    return false;
+                }
+                interpreter->fields.columns[column][field] = AS_NUMBER(value);
+                break;
+            }
             case     OP_DEFINE_LOCAL:
             {
 
@@ -1015,9 +1230,12 @@ bool Process::run( )
 
                 defineLocals++;
                 Value value = pop();
-                printf("DEFINE_LOCAL[%d] = ", defineLocals);
-                PRINT_VALUE(value);
-                printf("\n");
+                if (trace >= TRACE_STACK)
+                {
+                    printf("DEFINE_LOCAL[%d] = ", defineLocals);
+                    PRINT_VALUE(value);
+                    printf("\n");
+                }
                 frame->slots[defineLocals] = value;
                 break;
             }
@@ -1049,6 +1267,14 @@ bool Process::run( )
             {
                 u16 offset = READ_SHORT();
                 frame->ip -= offset;
+                // Charged by the size of the loop body, which is close
+                // enough to the instructions it ran without counting each.
+                budget -= offset;
+                if (budget <= 0)
+                {
+                    preempted = true; // resumes at the top of the loop
+                    return true;
+                }
                 break;
             }
             case OP_NOW:
@@ -1060,7 +1286,7 @@ bool Process::run( )
             default:
             {
                 runtimeError("Unimplemented opcode."+String(instruction));
-                status = STATUS_DEAD;
+                setStatus(STATUS_DEAD);
                 return false;
             }
         }
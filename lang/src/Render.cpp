@@ -0,0 +1,75 @@
+#include "Render.hpp"
+#include "Utils.hpp"
+#include <chrono>
+
+
+RenderSnapshot::RenderSnapshot()
+{
+    sprites = nullptr;
+    count = 0;
+    capacity = 0;
+    dead = 0;
+    tick = 0;
+    published = 0;
+}
+
+RenderSnapshot::~RenderSnapshot()
+{
+    std::free(sprites);
+}
+
+bool RenderSnapshot::reserve(u32 size)
+{
+    if (size <= capacity) return true;
+
+    u32 newCapacity = capacity < 64 ? 64 : capacity;
+    while (newCapacity < size) newCapacity *= 2;
+
+    RenderSprite* block = (RenderSprite*) std::realloc(sprites, newCapacity * sizeof(RenderSprite));
+    if (!block)
+    {
+        ERROR("Out of memory for render snapshot");
+        return false;
+    }
+    sprites = block;
+    capacity = newCapacity;
+    return true;
+}
+
+
+RenderBuffer::RenderBuffer()
+{
+    back = 0;
+    ready = 1;
+    front = 2;
+    fresh = false;
+}
+
+void RenderBuffer::publish()
+{
+    slots[back].published = now();
+    std::lock_guard<std::mutex> guard(mutex);
+    u32 swap = ready;
+    ready = back;
+    back = swap;
+    fresh = true;
+}
+
+RenderSnapshot* RenderBuffer::read()
+{
+    std::lock_guard<std::mutex> guard(mutex);
+    if (fresh)
+    {
+        u32 swap = front;
+        front = ready;
+        ready = swap;
+        fresh = false;
+    }
+    return &slots[front];
+}
+
+u64 RenderBuffer::now()
+{
+    return (u64)std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
@@ -0,0 +1,231 @@
+#include "VM.hpp"
+#include "Scheduler.hpp"
+
+
+RunQueue::RunQueue()
+{
+    for (u32 i = 0; i < WORDS; i++) mask[i] = 0;
+}
+
+u32 RunQueue::bucket(s32 priority)
+{
+    if (priority < PRIORITY_MIN) priority = PRIORITY_MIN;
+    if (priority > PRIORITY_MAX) priority = PRIORITY_MAX;
+    return (u32)(priority - PRIORITY_MIN);
+}
+
+void RunQueue::push(Process* process)
+{
+    u32 index = bucket(process->priority);
+    process->sched.unlink();
+    buckets[index].push_back(&process->sched);
+    process->queued = true;
+    mask[index / 64] |= 1ull << (index % 64);
+}
+
+// Moves every process of other into the matching bucket here, keeping
+// order. Costs one splice per non-empty bucket, not per process.
+void RunQueue::splice(RunQueue* other)
+{
+    for (u32 word = 0; word < WORDS; word++)
+    {
+        u64 bits = other->mask[word];
+        while (bits)
+        {
+            u32 bit = __builtin_ctzll(bits);
+            bits &= bits - 1;
+            u32 index = word * 64 + bit;
+            if (!other->buckets[index].empty())
+            {
+                buckets[index].splice_back(&other->buckets[index]);
+                mask[word] |= 1ull << bit;
+            }
+        }
+        other->mask[word] = 0;
+    }
+}
+
+// Reorders every bucket so that instances of one blueprint run back to
+// back. Blueprints keep the order in which they first appear in the bucket
+// and instances keep their FIFO order, so this is a stable bucket sort.
+void RunQueue::group()
+{
+    for (u32 word = 0; word < WORDS; word++)
+    {
+        u64 bits = mask[word];
+        while (bits)
+        {
+            u32 bit = __builtin_ctzll(bits);
+            bits &= bits - 1;
+            SchedLink* list = &buckets[word * 64 + bit];
+            if (list->next->next == list) continue; // zero or one process
+
+            ProcessBlueprint* first = nullptr;
+            ProcessBlueprint* last = nullptr;
+            SchedLink loose;
+            while (Process* process = list->pop_front())
+            {
+                ProcessBlueprint* blueprint = process->blueprint;
+                if (!blueprint)
+                {
+                    loose.push_back(&process->sched);
+                    continue;
+                }
+                if (blueprint->group.empty())
+                {
+                    blueprint->groupNext = nullptr;
+                    if (last) last->groupNext = blueprint;
+                    else first = blueprint;
+                    last = blueprint;
+                }
+                blueprint->group.push_back(&process->sched);
+            }
+
+            for (ProcessBlueprint* blueprint = first; blueprint; blueprint = blueprint->groupNext)
+            {
+                list->splice_back(&blueprint->group);
+            }
+            list->splice_back(&loose);
+        }
+    }
+}
+
+Process* RunQueue::pop()
+{
+    for (s32 word = WORDS - 1; word >= 0; word--)
+    {
+        while (mask[word])
+        {
+            u32 bit = 63 - __builtin_clzll(mask[word]);
+            u32 index = word * 64 + bit;
+            Process* process = buckets[index].pop_front();
+            if (buckets[index].empty())
+            {
+                mask[word] &= ~(1ull << bit);
+            }
+            if (process)
+            {
+                process->queued = false;
+                return process;
+            }
+        }
+    }
+    return nullptr;
+}
+
+bool RunQueue::empty()
+{
+    for (u32 word = 0; word < WORDS; word++)
+    {
+        u64 bits = mask[word];
+        while (bits)
+        {
+            u32 bit = __builtin_ctzll(bits);
+            bits &= bits - 1;
+            if (!buckets[word * 64 + bit].empty()) return false;
+            mask[word] &= ~(1ull << bit);
+        }
+    }
+    return true;
+}
+
+
+TimerWheel::TimerWheel()
+{
+    current = 0;
+}
+
+void TimerWheel::reset(u64 now)
+{
+    current = now / RESOLUTION;
+}
+
+void TimerWheel::insert(Process* process)
+{
+    u64 slot = process->wake_time / RESOLUTION;
+    if (slot < current) slot = current;
+    u64 delta = slot - current;
+
+    SchedLink* list = nullptr;
+    if (delta < LEVEL0_SIZE)
+    {
+        list = &level0[slot & (LEVEL0_SIZE - 1)];
+    }
+    else
+    {
+        for (u32 level = 0; level < UPPER_LEVELS; level++)
+        {
+            u32 shift = LEVEL0_BITS + level * LEVEL_BITS;
+            if (delta < (1ull << (shift + LEVEL_BITS)))
+            {
+                list = &upper[level][(slot >> shift) & (LEVEL_SIZE - 1)];
+                break;
+            }
+        }
+        if (!list)
+        {
+            u32 shift = LEVEL0_BITS + (UPPER_LEVELS - 1) * LEVEL_BITS;
+            slot = current + (1ull << (shift + LEVEL_BITS)) - 1;
+            list = &upper[UPPER_LEVELS - 1][(slot >> shift) & (LEVEL_SIZE - 1)];
+        }
+    }
+
+    process->sched.unlink();
+    list->push_back(&process->sched);
+}
+
+void TimerWheel::expire(SchedLink* slot, u64 now, SchedLink* due)
+{
+    if (slot->empty()) return;
+
+    SchedLink pending;
+    pending.splice_back(slot);
+    while (Process* process = pending.pop_front())
+    {
+        if (process->wake_time <= now)
+            due->push_back(&process->sched);
+        else
+            insert(process); // later in this same millisecond
+    }
+}
+
+void TimerWheel::cascade(SchedLink* slot)
+{
+    if (slot->empty()) return;
+
+    SchedLink pending;
+    pending.splice_back(slot);
+    while (Process* process = pending.pop_front())
+    {
+        insert(process);
+    }
+}
+
+// Moves every process whose wake-up time is <= now onto due, in wake order
+// per millisecond. The current slot is re-scanned on the next call so that
+// sub-millisecond wake times are not lost.
+void TimerWheel::advance(u64 now, SchedLink* due)
+{
+    u64 target = now / RESOLUTION;
+
+    for (;;)
+    {
+        expire(&level0[current & (LEVEL0_SIZE - 1)], now, due);
+        if (current >= target) break;
+
+        current++;
+        if ((current & (LEVEL0_SIZE - 1)) == 0)
+        {
+            // Highest level first, so entries it drops into a lower level's
+            // current slot are cascaded again right after.
+            for (s32 level = UPPER_LEVELS - 1; level >= 0; level--)
+            {
+                u32 shift = LEVEL0_BITS + level * LEVEL_BITS;
+                if ((current & ((1ull << shift) - 1)) == 0)
+                {
+                    cascade(&upper[level][(current >> shift) & (LEVEL_SIZE - 1)]);
+                }
+            }
+        }
+    }
+}
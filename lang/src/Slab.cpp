@@ -0,0 +1,178 @@
+#include "Slab.hpp"
+#include "Utils.hpp"
+
+const u32 SlabHeap::classSizes[CLASS_COUNT] = {
+    32, 48, 64, 80, 96, 112, 128, 144, 160, 176, 192, 208, 224, 240, 256,
+    320, 384, 512, 768, 1024, 2048
+};
+
+
+SlabHeap::SlabHeap()
+{
+    pages = nullptr;
+    for (u32 i = 0; i < CLASS_COUNT; i++) freePages[i] = nullptr;
+    sweepCursor = nullptr;
+    sweeping = false;
+    objects = 0;
+    bytes = 0;
+    allocated = 0;
+    pageCount = 0;
+    pageBytes = 0;
+}
+
+SlabHeap::~SlabHeap()
+{
+    while (pages)
+    {
+        SlabPage* next = pages->next;
+        std::free(pages);
+        pages = next;
+    }
+}
+
+u32 SlabHeap::classOf(size_t size)
+{
+    if (size <= 32) return 0;
+    if (size <= 256) return (u32)((size - 17) / 16);
+    for (u32 i = 15; i < CLASS_COUNT; i++)
+    {
+        if (size <= classSizes[i]) return i;
+    }
+    return LARGE;
+}
+
+SlabPage* SlabHeap::newPage(u32 sizeClass, size_t slotSize)
+{
+    size_t size = SlabPage::SIZE;
+    if (sizeClass == LARGE)
+    {
+        size = (SlabPage::header() + slotSize + SlabPage::SIZE - 1) & ~(SlabPage::SIZE - 1);
+    }
+
+    SlabPage* page = (SlabPage*) std::aligned_alloc(SlabPage::SIZE, size);
+    if (!page)
+    {
+        ERROR("Out of memory for a heap page (%zu bytes)", size);
+        return nullptr;
+    }
+    memset(page, 0, SlabPage::header());
+    page->sizeClass = sizeClass;
+    page->slotSize = (u32)slotSize;
+    page->slotCount = sizeClass == LARGE ? 1 : (u32)((SlabPage::SIZE - SlabPage::header()) / slotSize);
+    page->swept = true; // ahead of the sweep cursor, nothing to sweep yet
+
+    page->next = pages;
+    if (pages) pages->prev = page;
+    pages = page;
+
+    pageCount++;
+    pageBytes += size;
+    return page;
+}
+
+void SlabHeap::freePage(SlabPage* page)
+{
+    if (page->listed) unlist(page);
+    if (page->prev) page->prev->next = page->next;
+    else pages = page->next;
+    if (page->next) page->next->prev = page->prev;
+
+    pageCount--;
+    pageBytes -= page->sizeClass == LARGE
+        ? (SlabPage::header() + page->slotSize + SlabPage::SIZE - 1) & ~(SlabPage::SIZE - 1)
+        : SlabPage::SIZE;
+    std::free(page);
+}
+
+void SlabHeap::list(SlabPage* page)
+{
+    SlabPage*& first = freePages[page->sizeClass];
+    page->prevFree = nullptr;
+    page->nextFree = first;
+    if (first) first->prevFree = page;
+    first = page;
+    page->listed = true;
+}
+
+void SlabHeap::unlist(SlabPage* page)
+{
+    if (page->prevFree) page->prevFree->nextFree = page->nextFree;
+    else freePages[page->sizeClass] = page->nextFree;
+    if (page->nextFree) page->nextFree->prevFree = page->prevFree;
+    page->nextFree = nullptr;
+    page->prevFree = nullptr;
+    page->listed = false;
+}
+
+void* SlabHeap::allocate(size_t size, bool black)
+{
+    u32 sizeClass = classOf(size);
+    SlabPage* page;
+    if (sizeClass == LARGE)
+    {
+        page = newPage(LARGE, size);
+        if (!page) return nullptr;
+    }
+    else
+    {
+        page = freePages[sizeClass];
+        if (!page)
+        {
+            page = newPage(sizeClass, classSizes[sizeClass]);
+            if (!page) return nullptr;
+            list(page);
+        }
+    }
+
+    // The lowest clear bit is below slotCount: the page has a free slot
+    // and no bit past slotCount is ever set.
+    u32 word = page->hint;
+    while (page->used[word] == ~0ull) word++;
+    u64 bit = 1ull << lowestBit(~page->used[word]);
+    page->used[word] |= bit;
+    page->hint = word;
+    if (black || (sweeping && !page->swept)) page->marked[word] |= bit;
+
+    page->live++;
+    objects++;
+    bytes += page->slotSize;
+    allocated += page->slotSize;
+    if (page->listed && page->live == page->slotCount) unlist(page);
+
+    return page->slots() + (size_t)(word * 64 + lowestBit(bit)) * page->slotSize;
+}
+
+void SlabHeap::beginSweep()
+{
+    for (SlabPage* page = pages; page; page = page->next)
+    {
+        page->swept = false;
+    }
+    sweepCursor = pages;
+    sweeping = true;
+}
+
+// Bookkeeping after a page was swept. An empty page goes back to the
+// system, except the last one of its class with room.
+void SlabHeap::finishPage(SlabPage* page, u32 freed)
+{
+    page->swept = true;
+    if (freed == 0) return;
+
+    page->live -= freed;
+    objects -= freed;
+    bytes -= (size_t)freed * page->slotSize;
+    page->hint = 0;
+
+    if (page->live == 0)
+    {
+        SlabPage* first = page->sizeClass == LARGE ? nullptr : freePages[page->sizeClass];
+        bool spare = page->sizeClass != LARGE && (!first || (first == page && !page->nextFree));
+        if (!spare)
+        {
+            freePage(page);
+            return;
+        }
+    }
+    if (!page->listed && page->sizeClass != LARGE) list(page);
+}
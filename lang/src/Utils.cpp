@@ -1,6 +1,7 @@
 
 #include "Config.hpp"
 #include "Utils.hpp"
+#include <charconv>
 
 
  size_t string_hash(const char *str)
@@ -19,10 +20,44 @@
  const char *doubleToString(double value)
 {
     static char buffer[BUFFER_SIZE];
-    snprintf(buffer, BUFFER_SIZE, "%f", value);
+    formatNumber(value, buffer);
     return buffer;
 }
 
+u32 formatNumber(double value, char* buffer)
+{
+    // Whole numbers are by far the common case (scores, counters, ids)
+    if (value > -1e15 && value < 1e15 && value == (double)(long long)value)
+    {
+        long long whole = (long long)value;
+        char digits[NUMBER_BUFFER_SIZE];
+        u32 count = 0;
+        unsigned long long rest = whole < 0 ? 0ull - (unsigned long long)whole : (unsigned long long)whole;
+        do
+        {
+            digits[count++] = (char)('0' + rest % 10);
+            rest /= 10;
+        } while (rest);
+
+        u32 length = 0;
+        if (whole < 0) buffer[length++] = '-';
+        while (count) buffer[length++] = digits[--count];
+        buffer[length] = '\0';
+        return length;
+    }
+
+    // Shortest round trip (Ryu in the standard libraries we build with)
+    std::to_chars_result result = std::to_chars(buffer, buffer + NUMBER_BUFFER_SIZE - 1, value);
+    *result.ptr = '\0';
+    return (u32)(result.ptr - buffer);
+}
+
+bool parseNumber(const char* text, size_t length, double* value)
+{
+    std::from_chars_result result = std::from_chars(text, text + length, *value);
+    return result.ec == std::errc() && result.ptr == text + length;
+}
+
   const char *longToString(long value)
 {
     static char buffer[BUFFER_SIZE];
@@ -1,19 +1,21 @@
 #include "VM.hpp"
 #include "Utils.hpp"
 #include "Parser.hpp"
+#include <new>
+#ifdef USE_GRAPHICS
 #include <raylib.h>
+#endif
 GarbageCollector GC;
 
+#ifdef USE_GRAPHICS
 extern Texture2D dummy;
+#endif
 
 
 void Value::cleanup()
 {
-   if (type == ValueType::STRING && string)
-   {
-       delete []string;
-       string = nullptr;
-   }        
+   // Strings belong to the collector, just drop the reference
+   if (type == ValueType::STRING) string = nullptr;
 }
 
 Value Value::clone() const 
@@ -25,106 +27,47 @@ Value Value::clone() const
     {
         case ValueType::BOOL: v.boolean = boolean; break;
         case ValueType::NUMBER: v.number = number; break;
-        case ValueType::STRING: v.string = new ObjString(*string); break;
+        case ValueType::STRING: v.string = string; break; // immutable, share it
         case ValueType::OBJ: v.string = string; break;
         default: break;
     }
     return v;
 }
 
-ObjString::ObjString():GCObject(ObjType::STRING) 
+ObjString* ObjString::create(void* memory, const char* text, size_t length, u32 hash)
 {
-    length = 0;
-    data = nullptr;
-}
-
-ObjString::ObjString(const char* str) :GCObject(ObjType::STRING)
-{
-    length = strlen(str);
-    data = new char[length + 1];
-    strcpy(data, str);
-    data[length] = '\0';
-}
-
-ObjString::ObjString(const char* str, size_t length) :GCObject(ObjType::STRING)
-{
-    this->length = length;
-    data = new char[length + 1];
-    strcpy(data, str);
-    data[length] = '\0';
-
-}
-
-ObjString::ObjString(int value) :GCObject(ObjType::STRING)
-{
-    length = snprintf(nullptr, 0, "%d", value);
-    data = new char[length + 1];
-    snprintf(data, length + 1, "%d", value);
-}
-
-ObjString::ObjString(double value) :GCObject(ObjType::STRING)
-{
-    length = snprintf(nullptr, 0, "%f", value);
-    data = new char[length + 1];
-    snprintf(data, length + 1, "%f", value);
-}
-
-ObjString::~ObjString()
-{
-   //INFO("deleting string: %s", data);
-    if (!data) return;
-    delete[] data;
+    ObjString* string = new (memory) ObjString();
+    string->length = (int)length;
+    string->hash = hash;
+    string->isInterned = false;
+    memcpy(string->data, text, length);
+    string->data[length] = '\0';
+    return string;
 }
 
 
 GarbageCollector::GarbageCollector()
-    : head(nullptr), roots(nullptr), rootCount(0), rootCapacity(32)
+    : roots(nullptr), rootCount(0), rootCapacity(32),
+      phase(GC_IDLE), threshold(MIN_THRESHOLD),
+      nursery(nullptr), nurseryTop(0), youngBytes(0), nurseryOpen(false), internRuntime(false)
 {}
 
 GarbageCollector::~GarbageCollector()
 {
     INFO("deleting garbage collector");
-    for(u32 i = 0; i < stringPool.size(); i++)
-    {
-        delete stringPool[i];
-    }
-
-    while (head)
-    {
-        GCObject* next = head->next;
-        delete head;
-        head = next;
-    }
     delete[] roots;
+    std::free(nursery);
 }
 
 
-void GarbageCollector::addObject(GCObject* obj)
+// Called by the sweep for an unmarked object, right before its slot is
+// reused. Interned strings leave the table here, which is what makes the
+// table weak.
+void GarbageCollector::release(GCObject* obj)
 {
-    if (head)
-    {
-        head->prev = obj;
-    }
-    obj->next = head;
-    obj->prev = nullptr;
-    head = obj;
-}
-
-
-void GarbageCollector::removeObject(GCObject* obj)
-{
-    if (obj->prev)
-    {
-        obj->prev->next = obj->next;
-    }
-    else
-    {
-        head = obj->next;
-    }
-
-    if (obj->next)
+    if (obj->type == ObjType::STRING && ((ObjString*)obj)->isInterned)
     {
-        obj->next->prev = obj->prev;
+        strings.remove((ObjString*)obj);
     }
 }
 
@@ -149,8 +92,13 @@ void GarbageCollector::addRoot(GCObject** root)
     roots[rootCount++] = root;
 }
 
+// Stop-the-world collection from the registered roots only. The
+// interpreter's roots are not among them: this is for shutdown, or for a
+// host that keeps every live object in addRoot() slots.
 void GarbageCollector::collect()
 {
+    phase = GC_IDLE;
+
     // Fase Mark
     for (int i = 0; i < rootCount; i++)
     {
@@ -161,64 +109,181 @@ void GarbageCollector::collect()
     }
 
     // Fase Sweep
-    GCObject* current = head;
-    while (current)
-    {
-        GCObject* next = current->next;
+    heap.beginSweep();
+    while (heap.sweepPage([this](void* object) { release((GCObject*)object); })) {}
+}
 
-        if (current->isMarked)
-        {
-            current->isMarked = false; // Reset para próxima coleta
-        }
-        else
+// Everything is white at this point: the last sweep cleared the marks of
+// the survivors and objects allocated since then start unmarked.
+void GarbageCollector::beginMark()
+{
+    phase = GC_MARK;
+    for (int i = 0; i < rootCount; i++)
+    {
+        if (*roots[i] != nullptr)
         {
-            removeObject(current);
-            delete current;
+            markObject(*roots[i]);
         }
-
-        current = next;
     }
 }
 
+void GarbageCollector::beginSweep()
+{
+    std::lock_guard<std::mutex> guard(lock);
+    phase = GC_SWEEP;
+    heap.beginSweep();
+}
 
-int GarbageCollector::countObjects()
+// Frees unmarked objects a page at a time until every page is done or
+// deadline (SystemClock microseconds) has passed. Returns true once the
+// cycle is over.
+bool GarbageCollector::sweep(u64 deadline)
 {
-    int count = 0;
-    GCObject* current = head;
-    while (current)
+    SystemClock clock;
+    u32 swept = 0;
+    while (heap.sweepPage([this](void* object) { release((GCObject*)object); }))
     {
-        count++;
-        current = current->next;
+        if ((++swept & 3) == 0 && clock.now() >= deadline) return false;
     }
-    return count;
+
+    phase = GC_IDLE;
+    threshold = heap.objectCount() * 2;
+    if (threshold < MIN_THRESHOLD) threshold = MIN_THRESHOLD;
+    return true;
 }
 
 ObjString* GarbageCollector::newString(const String& str) 
 {
-    ObjString* string = new ObjString(str.c_str(), str.length());
-    stringPool.push_back(string);
-    return string;
+    return newString(str.c_str(), str.length());
 }
 
 ObjString* GarbageCollector::newString(const char* str) 
 { 
-    ObjString* string = new ObjString(str);
-  //  stringPool.push_back(string);
+    return newString(str, strlen(str));
+}
+
+ObjString* GarbageCollector::newString(const char* text, size_t length)
+{
+    if (!nurseryOpen) return intern(text, length);
+    if (internRuntime)
+    {
+        ObjString* string = findInterned(text, length);
+        if (string) return string;
+    }
+    return newYoungString(text, length);
+}
+
+// Caller holds the lock. A string found while a cycle runs is about to be
+// handed out again, so it gets marked: while marking that keeps it alive,
+// and during a sweep it saves it if the sweep has not reached it yet (a
+// string the sweep has passed then keeps its mark for one extra cycle).
+ObjString* GarbageCollector::lookup(const char* text, size_t length, u32 hash)
+{
+    ObjString* string = strings.find(text, length, hash);
+    if (string && phase != GC_IDLE) SlabHeap::mark(string);
     return string;
 }
 
+ObjString* GarbageCollector::intern(const char* text, size_t length)
+{
+    return intern(text, length, ObjString::hashOf(text, length));
+}
+
+ObjString* GarbageCollector::intern(const char* text, size_t length, u32 hash)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    ObjString* string = lookup(text, length, hash);
+    if (string) return string;
+
+    void* memory = heap.allocate(ObjString::sizeFor(length), phase == GC_MARK);
+    if (!memory)
+    {
+        ERROR("Out of memory for a string of %zu bytes", length);
+        return nullptr;
+    }
+    string = ObjString::create(memory, text, length, hash);
+    string->isInterned = strings.insert(string);
+    return string;
+}
+
+ObjString* GarbageCollector::findInterned(const char* text, size_t length)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    return lookup(text, length, ObjString::hashOf(text, length));
+}
+
+// Falls back to the (interned) old space when no tick is running or the
+// nursery is full, so callers never have to care where the string ended up.
+ObjString* GarbageCollector::newYoungString(const char* text, size_t length)
+{
+    if (nurseryOpen)
+    {
+        size_t size = (ObjString::sizeFor(length) + 7) & ~(size_t)7;
+        size_t offset = nurseryTop.fetch_add(size, std::memory_order_relaxed);
+        if (offset + size <= NURSERY_SIZE)
+        {
+            // Most die young, so the hash waits for promotion
+            ObjString* string = ObjString::create(nursery + offset, text, length, 0);
+            string->isYoung = true;
+            return string;
+        }
+    }
+    return intern(text, length);
+}
+
+// Swaps a young string for its interned old copy, made on first use;
+// later calls for the same string go through the forward pointer until the
+// nursery is dropped.
+ObjString* GarbageCollector::promote(ObjString* string)
+{
+    if (!string->isYoung) return string;
+    if (!string->forward)
+    {
+        string->forward = intern(string->data, (size_t)string->length);
+    }
+    return (ObjString*)string->forward;
+}
+
+void GarbageCollector::openNursery()
+{
+    if (!nursery)
+    {
+        nursery = (u8*)std::malloc(NURSERY_SIZE);
+        if (!nursery)
+        {
+            ERROR("Out of memory for the nursery");
+            return;
+        }
+    }
+    nurseryTop.store(0, std::memory_order_relaxed);
+    nurseryOpen = true;
+}
+
+// Drops every young string. Only valid once nothing refers to them any
+// more, i.e. every survivor has been promoted.
+void GarbageCollector::closeNursery()
+{
+    nurseryOpen = false;
+    // The top runs past the end once strings start falling back to the heap
+    size_t used = nurseryTop.exchange(0, std::memory_order_relaxed);
+    youngBytes += used < NURSERY_SIZE ? used : NURSERY_SIZE;
+}
 
 void GarbageCollector::markObject(GCObject* obj)
 {
-    if (!obj || obj->isMarked) return;
+    if (!obj || obj->isYoung) return;
 
-    obj->isMarked = true;
-    obj->trace(this); // Objeto marca suas próprias referências
+    SlabHeap::mark(obj); // strings hold no references, nothing to trace
 }
 
 
 void GarbageCollector::mark(GCObject* obj) { markObject(obj); }
 
+void GarbageCollector::mark(const Value& value)
+{
+    if (value.type == ValueType::STRING) markObject(value.string);
+}
+
 Value INTEGER(int value)
 {
     Value v;
@@ -302,8 +367,7 @@ bool MATCH(const Value& value, const Value& with)
     if (value.type != with.type) return false;
     if (IS_STRING(value) && IS_STRING(with))
     {
-        if (AS_STRING(value)->length != AS_STRING(with)->length) return false;
-        return strcmp(AS_STRING(value)->data, AS_STRING(with)->data) == 0;
+        return AS_STRING(value)->equals(AS_STRING(with));
     }
     else if (IS_NUMBER(value) && IS_NUMBER(with))
         return fabs(AS_NUMBER(value) - AS_NUMBER(with))
@@ -320,7 +384,15 @@ bool MATCH(const Value& value, const Value& with)
 Value STRING(const char* value)
 {
     Value v;
-    v.string = GC.allocate<ObjString>(value); // <ObjString>(value>
+    v.string = GC.newString(value);
+    v.type = ValueType::STRING;
+    return v;
+}
+
+Value STRING(const char* value, size_t length)
+{
+    Value v;
+    v.string = GC.newString(value, length);
     v.type = ValueType::STRING;
     return v;
 }
@@ -336,11 +408,12 @@ Value SHARED_STRING(const char* value)
  
 void PRINT_VALUE(const Value& value)
 {
+    char number[NUMBER_BUFFER_SIZE];
      switch (value.type)
     {
         case ValueType::NIL: printf("nil"); break;
         case ValueType::BOOL: printf("%s", value.boolean ? "true" : "false"); break;
-        case ValueType::NUMBER: printf("%f", value.number); break;
+        case ValueType::NUMBER: formatNumber(value.number, number); fputs(number, stdout); break;
         case ValueType::STRING: printf("%s", value.string->data); break;
         case ValueType::OBJ: printf("object"); break;
         case ValueType::FUNCTION: printf("<%s>", value.function->name); break;
@@ -352,11 +425,12 @@ void PRINT_VALUE(const Value& value)
 
 void Value::print()
 {
+    char text[NUMBER_BUFFER_SIZE];
     switch (type)
     {
         case ValueType::NIL: printf("nil\n"); break;
         case ValueType::BOOL: printf("%s\n", boolean ? "true" : "false"); break;
-        case ValueType::NUMBER: printf("N:%f\n", number); break;
+        case ValueType::NUMBER: formatNumber(number, text); printf("N:%s\n", text); break;
         case ValueType::STRING: printf("S:%s\n", string->data); break;
         case ValueType::OBJ: printf("object\n"); break;
         case ValueType::FUNCTION: printf("<%s>\n", function->name); break;
@@ -367,23 +441,30 @@ void Value::print()
 }
 
 
-ObjFunction::ObjFunction():  arity(0)
+ObjFunction::ObjFunction():  arity(0), maxStack(0)
 {
+    Memory.allocate(MEMORY_FUNCTIONS, sizeof(ObjFunction));
     memcpy(name, "function", 7);
     name[7] = '\0';
 }
-ObjFunction::ObjFunction(const String &n): arity(0)
+ObjFunction::ObjFunction(const String &n): arity(0), maxStack(0)
 {
+    Memory.allocate(MEMORY_FUNCTIONS, sizeof(ObjFunction));
     size_t len = n.length();
     strncpy(name, n.c_str(), len);
     name[len] = '\0';
 }
-ObjFunction::ObjFunction(const char *n):  arity(0)
+ObjFunction::ObjFunction(const char *n):  arity(0), maxStack(0)
 {
+    Memory.allocate(MEMORY_FUNCTIONS, sizeof(ObjFunction));
     size_t len = strlen(n);
     memccpy(name, n, '\0', len);
     name[len] = '\0';
 }
+ObjFunction::~ObjFunction()
+{
+    Memory.release(MEMORY_FUNCTIONS, sizeof(ObjFunction));
+}
 
 
 ObjProcess* Interpreter::add_raw_process(const char* name) 
@@ -398,20 +479,45 @@ Interpreter::Interpreter()
     first_instance = nullptr;
     last_instance = nullptr;
 
-    queu_processes.reserve(512);
+    queue_first = nullptr;
+    queue_last = nullptr;
+    spawn_policy = SPAWN_NEXT_TICK;
+    group_by_blueprint = false;
+    clock = 0;
+    tick_length = 1000000 / 60;
+    max_catchup = 5;
+    accumulator = 0;
+    instruction_budget = 1000000;
+    preemptions = 0;
+    parallel_phase = false;
+    threaded_render = false;
+    interpolate = false;
+    simulation_stop = false;
+    simulation_running = false;
+    time_source = &system_clock;
+    gc_budget = 500;
+    gc_cursor = nullptr;
+    memory_dump_ticks = 0;
+    memory_dump_file = nullptr;
+    input = &no_input;
+    running_process = nullptr;
  
     next_process_id = 1;
     current_frame = 0;
     frame_completed = false;
     must_exit = false;
     exit_value = 0;
+    trace_level = TRACE_NONE;
     first_instance = nullptr;
     last_instance = nullptr;
     parser = new Parser(this);
-    main_process = add_process("_main_", true, 0);
+    main_blueprint = new ProcessBlueprint("_main_");
+    main_process = add_process(main_blueprint, true, 0);
     first_instance = main_process;
     panicMode = false;
 
+    defineProcessNatives();
+    defineMemoryNatives();
     
 }
 
@@ -422,15 +528,7 @@ Interpreter::~Interpreter()
     delete parser;
    // delete first_instance;
     delete main_process;
-
-    if (queu_processes.getSize () > 0)
-    {
-        for (u32 i = 0; i < queu_processes.getSize (); i++)
-        {
-            delete queu_processes[i];
-        }
-        queu_processes.clear();
-    }
+    delete main_blueprint;
 
     // for (u32 i = 0; i < functions.getSize (); i++)
     // {
@@ -438,11 +536,11 @@ Interpreter::~Interpreter()
     // }
     // functions.clear();
 
-    for (u32 i = 0; i < processes.getSize (); i++)
+    for (u32 i = 0; i < blueprints.getSize (); i++)
     {
-        delete processes[i];
+        delete blueprints[i];
     }
-    processes.clear();
+    blueprints.clear();
  
     for (u32 i = 0; i < raw_processes.getSize (); i++)
     {
@@ -497,7 +595,20 @@ void Interpreter::clear()
         current = next;
     }
     first_instance = nullptr;   
-    main_process =      add_process("_main_", true, 0);
+
+    current = queue_first;
+    while (current)
+    {
+        Process* next = current->next;
+        delete current;
+        current = next;
+    }
+    queue_first = nullptr;
+    queue_last = nullptr;
+    gc_cursor = nullptr;
+    delete main_blueprint;
+    main_blueprint = new ProcessBlueprint("_main_");
+    main_process =      add_process(main_blueprint, true, 0);
     first_instance = main_process;
     panicMode = false;
 
@@ -505,10 +616,17 @@ void Interpreter::clear()
 
  u32 Interpreter::addConstant(Value value) 
  { 
+    GC.promote(&value);
     u32 count =  constants.getSize();
     for (u32 i = 0; i < count; i++)
     {
-        if (MATCH(value, constants[i]))
+        // MATCH compares numbers within a tolerance; a literal must keep
+        // its exact value
+        if (value.type == ValueType::NUMBER)
+        {
+            if (constants[i].type == ValueType::NUMBER && constants[i].number == value.number) return i;
+        }
+        else if (MATCH(value, constants[i]))
         {
             return i;
         }
@@ -517,45 +635,177 @@ void Interpreter::clear()
     return constants.getSize() - 1;
  }
 
- Process* Interpreter::create_process(const char* name)
+ ProcessBlueprint* Interpreter::create_blueprint(const char* name)
 {
-    Process* process = new Process(this, true);
-    memccpy(process->name, name, '\0', strlen(name));
-    processes.push_back(process);
-    return process;
+    ProcessBlueprint* blueprint = new ProcessBlueprint(name);
+    blueprints.push_back(blueprint);
+    return blueprint;
 }
 
 
-Process* Interpreter::queue_process(const char* name,   int32_t priority)
+Process* Interpreter::queue_process(ProcessBlueprint* blueprint,   int32_t priority)
 {
-    Process* process = new Process(this, false);
-    memccpy(process->name, name, '\0', strlen(name));
+    Process* process = new Process(this, blueprint, false);
     process->priority = priority;
  
-    process->frame_timer = 0.0;
-    process->frame_interval = 1.0 / 60.0; // Default to 60 FPS
+    process->wake_time = clock;
     process->priority = priority;
 
     process->next = nullptr;
-    process->prev = nullptr;
+    process->prev = queue_last;
+    spawned.push(process);
 
-    queu_processes.push_back(process);
+    if (queue_last)
+        queue_last->next = process;
+    else
+        queue_first = process;
+    queue_last = process;
 
     return process;
 }
 
-Process* Interpreter::add_process(const char* name, bool root, int32_t priority)
+// Splices everything spawned since the last call onto the end of the run
+// list, keeping spawn order.
+void Interpreter::admit_queued()
+{
+    if (!queue_first) return;
+
+    if (!first_instance)
+    {
+        first_instance = queue_first;
+    }
+    else
+    {
+        last_instance->next = queue_first;
+        queue_first->prev = last_instance;
+    }
+    last_instance = queue_last;
+    runnable.splice(&spawned);
+
+    queue_first = nullptr;
+    queue_last = nullptr;
+}
+
+// Files a process under the list matching its status. Running processes
+// always go through the wheel, so one that was just run is never picked up
+// again in the same tick. The process may still sit on another list: one
+// in a parallel batch can be killed or put to sleep by a deferred call
+// before its own turn to be filed comes.
+void Interpreter::schedule(Process* process)
+{
+    process->queued = false;
+    process->sched.unlink();
+    switch (process->status)
+    {
+        case STATUS_RUNNING: timers.insert(process); break;
+        case STATUS_SLEEPING: sleeping.push_back(&process->sched); break;
+        case STATUS_FROZEN: frozen.push_back(&process->sched); break;
+        case STATUS_WAITING: waiting.push_back(&process->sched); break;
+        case STATUS_PAUSED: paused.push_back(&process->sched); break;
+        default: dead.push_back(&process->sched); break;
+    }
+}
+
+void Interpreter::set_status(Process* process, ProcessStatus status)
 {
-    Process* process = new Process(this, root);
-    memccpy(process->name, name, '\0', strlen(name));
+    if (process->status == status) return;
+    process->setStatus(status);
+
+    // The scheduler files the running process itself once it yields.
+    if (process == running_process) return;
+
+    schedule(process);
+}
+
+// Only a process already waiting in a run queue needs moving; everywhere
+// else the new priority is picked up the next time it becomes runnable.
+void Interpreter::set_priority(Process* process, s32 priority)
+{
+    if (process->priority == priority) return;
+    process->priority = priority;
+
+    if (!process->queued || process == running_process) return;
+
+    // Spawned this tick and not admitted yet: serials only grow, so
+    // anything newer than the head of the spawn queue is still in it.
+    if (queue_first && process->serial >= queue_first->serial)
+        spawned.push(process);
+    else
+        runnable.push(process);
+}
+
+// Applies status to every live instance of blueprint and returns how many
+// it reached. The next node is taken first because a kill unlinks the
+// current one from the list.
+u32 Interpreter::signal_type(ProcessBlueprint* blueprint, ProcessStatus status)
+{
+    u32 count = 0;
+    SchedLink* list = &blueprint->instances;
+    SchedLink* node = list->next;
+    while (node != list)
+    {
+        SchedLink* next = node->next;
+        set_status(node->owner, status);
+        count++;
+        node = next;
+    }
+    return count;
+}
+
+// Applies status to process and all of its descendants, children before
+// their father so that a kill can unhook each child as it goes. Returns
+// how many processes were reached.
+u32 Interpreter::signal_tree(Process* process, ProcessStatus status)
+{
+    u32 count = 0;
+    SchedLink* list = &process->children;
+    SchedLink* node = list->next;
+    while (node != list)
+    {
+        SchedLink* next = node->next;
+        count += signal_tree(node->owner, status);
+        node = next;
+    }
+    set_status(process, status);
+    return count + 1;
+}
+
+ProcessBlueprint* Interpreter::find_blueprint(const char* name)
+{
+    for (u32 i = 0; i < blueprints.getSize(); i++)
+    {
+        if (strcmp(blueprints[i]->name, name) == 0)
+        {
+            return blueprints[i];
+        }
+    }
+    return nullptr;
+}
+
+void Interpreter::set_spawn_policy(SpawnPolicy policy)
+{
+    spawn_policy = policy;
+}
+
+// When enabled, each tick runs all due instances of one process type back
+// to back inside every priority level, so their bytecode and constants
+// stay hot in cache. Priority order between types is unchanged.
+void Interpreter::set_group_scheduling(bool enabled)
+{
+    group_by_blueprint = enabled;
+}
+
+Process* Interpreter::add_process(ProcessBlueprint* blueprint, bool root, int32_t priority)
+{
+    Process* process = new Process(this, blueprint, root);
     process->priority = priority;
  
-    process->frame_timer = 0.0;
-    process->frame_interval = 1.0 / 60.0; // Default to 60 FPS
+    process->wake_time = clock;
     process->priority = priority;
 
     process->next = nullptr;
     process->prev = nullptr;
+    runnable.push(process);
 
     
   if (!first_instance) 
@@ -580,6 +830,11 @@ void Interpreter::request_exit(s32 value)
     exit_value = value;
 }
 
+void Interpreter::set_trace_level(u32 level)
+{
+    trace_level = level;
+}
+
 u32 Interpreter::instance_count()
 {
     uint32_t count = 0;
@@ -604,68 +859,53 @@ void Interpreter::runtimeError(const String& message)
 
 
 
+// Kills every live instance of the named process type.
 bool Interpreter::kill_process(const char* name)
 {
-    Process* current = first_instance;
-    while (current)
-    {
-        if (strcmp(current->name, name) == 0)
-        {
-            current->status = STATUS_KILLED;
-            break;
-        }
-        current = current->next;
-    }
-    return false;
+    ProcessBlueprint* blueprint = find_blueprint(name);
+    if (!blueprint) return false;
+    return signal_type(blueprint, STATUS_KILLED) > 0;
 }
 
 bool Interpreter::kill_process(u32 pid)
 {
-    Process* current = first_instance;
-    while (current)
-    {
-        if (current->id == pid)
-        {
-            current->status = STATUS_KILLED;
-            break;
-        }
-        current = current->next;
-    }
-    return false;
+    Process* process = handles.get(pid);
+    if (!process || !process->is_alive()) return false;
+    set_status(process, STATUS_KILLED);
+    return true;
 }
 
 
+// Oldest live instance of the named process type: the head of its
+// blueprint's instance list, like kill_process(name).
 Process* Interpreter::find_process(const char* name)
 {
-    Process* current = first_instance;
-    while (current)
+    ProcessBlueprint* blueprint = find_blueprint(name);
+    if (!blueprint && main_blueprint && strcmp(main_blueprint->name, name) == 0)
     {
-        if (strcmp(current->name, name) == 0)
-        {
-            return current;
-        }
-        current = current->next;
+        blueprint = main_blueprint;
     }
-    return nullptr;
+    if (!blueprint || blueprint->instances.empty()) return nullptr;
+    return blueprint->instances.next->owner;
 }
 
+// O(1); returns nullptr for ids whose process has already been deleted,
+// even if its slot has been reused since.
 Process* Interpreter::find_process(u32 pid)
 {
-    Process* current = first_instance;
-    while (current)
-    {
-        if (current->id == pid)
-        {
-            return current;
-        }
-        current = current->next;
-    }
-    return nullptr;
+    return handles.get(pid);
+}
+
+bool Interpreter::process_exists(u32 pid)
+{
+    Process* process = handles.get(pid);
+    return process && process->is_alive();
 }
 
 
 bool Interpreter::has_alive_processes() const
 {
+    if (queue_first) return true; // spawned, runs next tick
     Process* current = first_instance;
     while (current)
     {
@@ -678,7 +918,7 @@ bool Interpreter::has_alive_processes() const
     return false;
 }
 
- void Interpreter::defineNative(const char* name, NativeFn function) 
+ void Interpreter::defineNative(const char* name, NativeFn function, bool threadSafe) 
  {
     if (main_process == nullptr) 
     {
@@ -687,7 +927,7 @@ bool Interpreter::has_alive_processes() const
 
     }
 
-    ObjNative *native = new ObjNative(function);
+    ObjNative *native = new ObjNative(function, threadSafe);
  
 
    // natives.push_back(native);
@@ -702,13 +942,21 @@ bool Interpreter::has_alive_processes() const
     }
 
     main_process->pop();
-    Value b =main_process->pop();
-    delete b.string;
+    main_process->pop(); // the name is the interned global key now, GC owns it
  
 
 
 }
 
+void Interpreter::defineProcessNative(const char* name, ProcessNativeFn function, bool threadSafe)
+{
+    ObjNative *native = new ObjNative(function, threadSafe);
+    if (!define(name, NATIVE(native)))
+    {
+        WARNING("Native %s already defined", name);
+    }
+}
+
 void Interpreter::defineNatives(const NativeReg* natives) 
 {
     for (int i = 0; natives[i].name != nullptr; ++i) 
@@ -722,10 +970,18 @@ void Interpreter::defineNatives(const NativeReg* natives)
  
 bool Interpreter::define(const char* name, Value value) 
 {
-    if (globals.contains(name))
+    return define(GC.intern(name, strlen(name)), std::move(value));
+}
+
+bool Interpreter::define(ObjString* name, Value value)
+{
+    if (!name->isInterned) name = GC.intern(name->data, name->length, name->hash);
+    GC.promote(&value);
+    GC.shade(value);
+    Value* slot = globals.find(name);
+    if (slot)
     {
-      //  WARNING("Variable %s already defined", name);
-        globals[name] = std::move(value);
+        *slot = std::move(value);
         return true;
     }
     globals.insert(name, std::move(value));
@@ -734,16 +990,39 @@ bool Interpreter::define(const char* name, Value value)
 
 bool Interpreter::contains(const char* name) 
 { 
-    return globals.contains(name);
+    ObjString* key = GC.findInterned(name, strlen(name));
+    return key && globals.contains(key);
 }
 
 Value Interpreter::get(const char* name)
 {
-    if (globals.contains(name))
+    ObjString* key = GC.findInterned(name, strlen(name));
+    Value* value = key ? globals.find(key) : nullptr;
+    return value ? *value : Value();
+}
+
+// Names from the constant table are interned, so this is a pointer hash
+// and compare.
+Value* Interpreter::find_global(ObjString* name)
+{
+    if (!name->isInterned)
     {
-        return globals[name];
+        name = GC.findInterned(name->data, name->length);
+        if (!name) return nullptr;
     }
-    return Value();
+    return globals.find(name);
+}
+
+// Also look up strings made while scripts run in the intern table, so
+// repeated results share one object. Costs a hash and a probe per string.
+void Interpreter::set_runtime_interning(bool enabled)
+{
+    GC.setRuntimeInterning(enabled);
+}
+
+void Interpreter::set_compiler_memory_limit(size_t bytes)
+{
+    parser->setMemoryLimit(bytes);
 }
 
 bool Interpreter::compile(const char* source)
@@ -769,6 +1048,7 @@ bool Interpreter::compile_file(const char* path)
 void Interpreter::remove_process_from_list(Process* process)
 {
     if (!process) return;
+    if (gc_cursor == process) gc_cursor = process->next;
     
     if (process->prev)
         process->prev->next = process->next;
@@ -779,92 +1059,331 @@ void Interpreter::remove_process_from_list(Process* process)
         process->next->prev = process->prev;
     else
         last_instance = process->prev;  
+
+    if (process == main_process)
+        main_process = nullptr;
     
     delete process;
 }
 
  
 
-u32 Interpreter::run()
+// One fixed simulation step. Every due process runs until its frame
+// percentage reaches 100: frame(200) runs twice in a tick, frame(50) runs
+// and then sits out the next tick. Nothing here reads wall-clock time, so
+// the same script gives the same ticks every time.
+u32 Interpreter::tick()
 {
-    must_exit = false;
-    
-    while ((!must_exit || !panicMode) && !WindowShouldClose())
+    current_frame++;
+    clock += tick_length;
+    GC.openNursery();
+    if (interpolate)
     {
-        
-        if (queu_processes.getSize() > 0)
+        fields.save();
+    }
+
+    admit_queued();
+    SchedLink due;
+    timers.advance(clock, &due);
+    while (Process* process = due.pop_front())
+    {
+        runnable.push(process);
+    }
+    if (group_by_blueprint)
+    {
+        runnable.group();
+    }
+
+    if (workers.size() > 1)
+    {
+        run_batch();
+    }
+    else
+    {
+        while (Process* i = runnable.pop())
         {
-            Process* process = queu_processes.back();
-            queu_processes.pop_back();
-            
-                if (!first_instance) 
-                {
-                        first_instance = process;
-                        last_instance = process;
-                    } else 
-                    {
-                        last_instance->next = process;
-                        process->prev = last_instance;
-                        last_instance = process;
-                    }
-           
+            prepare(i);
+            running_process = i;
+            step(i);
+            running_process = nullptr;
+            finish(i);
+
+            // Same-tick spawns join the run queue right away, so this loop
+            // still reaches them this tick.
+            if (spawn_policy == SPAWN_SAME_TICK)
+            {
+                admit_queued();
+            }
+
+            if (must_exit) break;
         }
+    }
+
+    u32 dead_count = 0;
+    while (Process* i = dead.pop_front())
+    {
+        dead_count++;
+        remove_process_from_list(i); // Updates last_instance if needed
+    }
+    GC.closeNursery();
 
+    MemoryReport report;
+    memory_report(&report);
+    memory_history.endTick(report);
+    collect_step();
+    if (memory_dump_ticks && current_frame % memory_dump_ticks == 0)
+    {
+        dump_memory(memory_dump_file);
+    }
+    return dead_count;
+}
 
+void Interpreter::prepare(Process* process)
+{
+    process->budget = instruction_budget ? (s64)instruction_budget : INT64_MAX;
+    process->preempted = false;
+    process->deferred = false;
+}
+
+// Runs a process until it has used up this tick's frame percentage, hits
+// its instruction budget, stops, or (on a worker) reaches an op that must
+// run on the main thread.
+void Interpreter::step(Process* process)
+{
+    while (process->status == STATUS_RUNNING && process->frame_percent < 100)
+    {
+        if (!process->run() || process->preempted || process->deferred) break;
+    }
+
+    // Whatever the stack still holds lives into the next tick.
+    if (process->is_alive())
+    {
+        for (Value* slot = process->stack; slot < process->stackTop; slot++)
+        {
+            GC.promote(slot);
+        }
+    }
+}
+
+// Books the time a process just used and files it for its next run.
+void Interpreter::finish(Process* i)
+{
+    if (i->status == STATUS_RUNNING)
+    {
+        if (i->preempted)
+        {
+            if (i->preemptions++ == 0)
+            {
+                WARNING("Process '%s' (%u) ran out of instruction budget, resuming next tick", i->name, i->id);
+            }
+            preemptions++;
+        }
+
+        // Whole hundreds left over are ticks to sit out; the rest
+        // carries into the next run.
+        s32 ticks = i->frame_percent / 100;
+        if (ticks < 1) ticks = 1;
+        i->frame_percent -= ticks * 100;
+        if (i->frame_percent < 0) i->frame_percent = 0;
+
+        u64 next = clock + (u64)ticks * tick_length;
+        if (i->wake_time < next) i->wake_time = next;
+    }
+    schedule(i);
+}
+
+void Interpreter::run_batch_task(void* context, u32 index)
+{
+    Interpreter* vm = (Interpreter*)context;
+    vm->step(vm->batch[index]);
+}
+
+// Parallel tick. Due processes run on the worker pool against the globals
+// as they were at the start of the batch; each process sees its own writes
+// and they are applied afterwards in run order, so the last writer in
+// priority/spawn order wins. Spawns, kills, print and natives not marked
+// thread-safe make the process stop on that instruction (deferred); those
+// processes then finish the tick one by one on this thread, in run order.
+// Nothing depends on which worker ran what, so results are the same for
+// any number of threads.
+void Interpreter::run_batch()
+{
+    while (!runnable.empty() && !must_exit)
+    {
+        batch.clear();
+        while (Process* i = runnable.pop())
+        {
+            prepare(i);
+            batch.push_back(i);
+        }
+
+        parallel_phase = true;
+        workers.run((u32)batch.size(), run_batch_task, this);
+        parallel_phase = false;
+
+        for (u32 n = 0; n < batch.size(); n++)
+        {
+            Process* i = batch[n];
+            for (u32 w = 0; w < i->pendingGlobals.size(); w++)
+            {
+                define(i->pendingGlobals[w].name, i->pendingGlobals[w].value);
+            }
+            i->pendingGlobals.clear();
+
+            // Deaths on a worker only set the status; unhook them here.
+            if (!i->is_alive())
+            {
+                i->leaveBlueprint();
+                i->leaveFamily();
+            }
+        }
+
+        for (u32 n = 0; n < batch.size() && !must_exit; n++)
+        {
+            Process* i = batch[n];
+            if (i->deferred)
+            {
+                running_process = i;
+                i->deferred = false;
+                step(i);
+                running_process = nullptr;
+            }
+            finish(i);
+        }
+
+        // Same-tick spawns get their own batch.
+        if (spawn_policy == SPAWN_SAME_TICK)
+        {
+            admit_queued();
+        }
+    }
+}
+
+// Runs ticks on count threads in total (this one included); 0 or 1 keeps
+// everything on the calling thread.
+void Interpreter::set_worker_threads(u32 count)
+{
+    workers.start(count);
+}
+
+// Advances count ticks back to back, without touching the window. Stops
+// early on request_exit(). Returns the number of ticks run.
+u32 Interpreter::run_ticks(u32 count)
+{
+    must_exit = false;
+    u32 done = 0;
+    while (done < count && !must_exit)
+    {
+        tick();
+        done++;
+    }
+    return done;
+}
+
+// Simulate on a separate thread inside run(). Takes effect on the next
+// call to run().
+void Interpreter::set_render_thread(bool enabled)
+{
+    threaded_render = enabled;
+}
+
+// Draw processes between their positions of the last two ticks instead of
+// snapping to the newest one. Adds one tick of display latency.
+void Interpreter::set_interpolation(bool enabled)
+{
+    if (enabled && !interpolate)
+    {
+        fields.save();
+    }
+    interpolate = enabled;
+}
+
+void Interpreter::set_tick_rate(u32 hz)
+{
+    if (hz == 0) hz = 1;
+    tick_length = 1000000 / hz;
+}
+
+// Caps how much bytecode a process may run per tick before it is
+// suspended until the next one. Checked only on loop back-edges and calls.
+void Interpreter::set_instruction_budget(u32 budget)
+{
+    instruction_budget = budget;
+}
+
+void Interpreter::set_max_catchup(u32 ticks)
+{
+    max_catchup = ticks < 1 ? 1 : ticks;
+}
+
+#ifdef USE_GRAPHICS
+u32 Interpreter::run()
+{
+    if (threaded_render)
+    {
+        return run_threaded();
+    }
+
+    must_exit = false;
+    input->capture();
+
+    while ((!must_exit || !panicMode) && !WindowShouldClose())
+    {
+        input->poll();
+        
         BeginDrawing();
         ClearBackground(BLACK);
         
-        double deltaTime = GetFrameTime();
-        current_frame++;
-        
- 
-        Process* i = first_instance;
-        uint32_t i_count = 0;
+        // Catch up on whole ticks of elapsed time. After a long stall only
+        // max_catchup ticks run and the rest of the backlog is dropped.
+        accumulator += (u64)(GetFrameTime() * 1000000.0 + 0.5);
+        u32 steps = 0;
         uint32_t dead_count = 0;
-        
-        while (i)
+        while (accumulator >= tick_length && steps < max_catchup && !must_exit)
         {
-            Process* next = i->next; // Safe iteration
-            ProcessStatus status = i->status;
-            
-            if (status == STATUS_RUNNING)
+            dead_count += tick();
+            accumulator -= tick_length;
+            steps++;
+        }
+        if (accumulator >= tick_length)
+        {
+            accumulator %= tick_length;
+        }
+
+        uint32_t i_count = 0;
+
+        // Render active, non-root processes straight from the field columns
+        const double* xs = fields.columns[ID_X];
+        const double* ys = fields.columns[ID_Y];
+        const u8* states = fields.status;
+        if (interpolate)
+        {
+            // accumulator is how far real time has got into the next
+            // tick; show the last one that far along.
+            double alpha = (double)accumulator / (double)tick_length;
+            const double* lastXs = fields.previous[ID_X];
+            const double* lastYs = fields.previous[ID_Y];
+            for (u32 row = 0; row < fields.count; row++)
             {
-                i->frame_timer += deltaTime;
-                
-                if (i->frame_timer >= i->frame_interval)
-                {
-                    bool still_running = i->run();
-                    
-                    if (still_running && i->status == STATUS_RUNNING)
-                    {
-                        i_count++;
-                        i->frame_timer -= i->frame_interval; // Maintain timing precision
-                    }
-                }
-                else
-                {
-                    i_count++; // Count waiting processes as active
-                }
-                
-                // Render active, non-root processes
-                if (i->status == STATUS_RUNNING && !i->root)
+                if (states[row] == STATUS_RUNNING)
                 {
-                    double x = i->stack[ID_X].number;
-                    double y = i->stack[ID_Y].number;
-                    DrawTexture(dummy, x, y, WHITE);
-                  // DrawCircle(x, y, 5, WHITE);
-                    // Optional: DrawText(TextFormat("FPS: %.0f", 1.0/i->frame_interval), x, y-20, 12, GRAY);
+                    i_count++;
+                    DrawTexture(dummy, lastXs[row] + (xs[row] - lastXs[row]) * alpha,
+                                lastYs[row] + (ys[row] - lastYs[row]) * alpha, WHITE);
                 }
             }
-            else if (status == STATUS_DEAD || status == STATUS_KILLED)
+        }
+        else
+        {
+            for (u32 row = 0; row < fields.count; row++)
             {
-                dead_count++;
-                remove_process_from_list(i); // Updates last_instance if needed
+                if (states[row] == STATUS_RUNNING)
+                {
+                    i_count++;
+                    DrawTexture(dummy, xs[row], ys[row], WHITE);
+                  // DrawCircle(xs[row], ys[row], 5, WHITE);
+                }
             }
-            
-            if (must_exit) break;
-            
-            i = next;
         }
         
         DrawFPS(10, 10);
@@ -873,10 +1392,208 @@ u32 Interpreter::run()
         
         
         EndDrawing();
+        input->capture();
     }
     
     return exit_value;
 }
+
+#endif
+
+// Copies what the renderer needs out of the field columns and hands it to
+// the render thread.
+void Interpreter::publish_frame(u32 dead_count)
+{
+    RenderSnapshot* frame = frames.write();
+    frame->count = 0;
+    frame->dead = dead_count;
+    frame->tick = current_frame;
+    if (!frame->reserve(fields.count)) return;
+
+    const u8* states = fields.status;
+    for (u32 row = 0; row < fields.count; row++)
+    {
+        if (states[row] != STATUS_RUNNING) continue;
+
+        RenderSprite* sprite = &frame->sprites[frame->count++];
+        sprite->x = (float)fields.columns[ID_X][row];
+        sprite->y = (float)fields.columns[ID_Y][row];
+        sprite->angle = (float)fields.columns[ID_ANGLE][row];
+        if (interpolate)
+        {
+            sprite->lastX = (float)fields.previous[ID_X][row];
+            sprite->lastY = (float)fields.previous[ID_Y][row];
+            sprite->lastAngle = (float)fields.previous[ID_ANGLE][row];
+        }
+        else
+        {
+            sprite->lastX = sprite->x;
+            sprite->lastY = sprite->y;
+            sprite->lastAngle = sprite->angle;
+        }
+    }
+    frames.publish();
+}
+
+// Body of the simulation thread: ticks at tick_length against the wall
+// clock and publishes a snapshot after every batch of ticks. Scripts only
+// ever run here, so the interpreter stays single-threaded (apart from the
+// worker pool, which this thread drives).
+void Interpreter::simulate()
+{
+    u64 last = time_source->now();
+    u32 dead_count = 0;
+    while ((!must_exit || !panicMode) && !simulation_stop.load(std::memory_order_relaxed))
+    {
+        u64 now = time_source->now();
+        accumulator += now - last;
+        last = now;
+
+        // Only when ticks are due: a poll with none to see it would drop
+        // the presses and releases it took over.
+        if (accumulator >= tick_length)
+        {
+            input->poll();
+        }
+
+        u32 steps = 0;
+        while (accumulator >= tick_length && steps < max_catchup && !must_exit)
+        {
+            dead_count += tick();
+            accumulator -= tick_length;
+            steps++;
+        }
+        if (accumulator >= tick_length)
+        {
+            accumulator %= tick_length;
+        }
+
+        if (steps > 0)
+        {
+            publish_frame(dead_count);
+            dead_count = 0;
+        }
+
+        if (accumulator < tick_length)
+        {
+            time_source->wait_until(now + tick_length - accumulator);
+        }
+    }
+    simulation_running.store(false, std::memory_order_release);
+}
+
+#ifdef USE_GRAPHICS
+
+// run() with the simulation on a thread of its own. This thread keeps the
+// window and only draws the newest snapshot, so vsync and GPU stalls no
+// longer hold up scripts and a slow tick no longer drops frames. Natives
+// that draw straight to the screen (draw_circle, ...) only work in the
+// single-threaded run(); hosts have them refuse calls off the window
+// thread. Input natives read the state the input source captured after
+// the last frame, handed over in its poll().
+u32 Interpreter::run_threaded()
+{
+    must_exit = false;
+    simulation_stop = false;
+    simulation_running = true;
+    input->capture();
+    simulation = std::thread(&Interpreter::simulate, this);
+
+    while (simulation_running.load(std::memory_order_acquire) && !WindowShouldClose())
+    {
+        RenderSnapshot* frame = frames.read();
+
+        // The snapshot is one tick old; blend towards it by the time that
+        // has passed since it was published.
+        float alpha = 1.0f;
+        if (interpolate)
+        {
+            u64 elapsed = RenderBuffer::now() - frame->published;
+            alpha = elapsed >= tick_length ? 1.0f : (float)elapsed / (float)tick_length;
+        }
+
+        BeginDrawing();
+        ClearBackground(BLACK);
+
+        for (u32 n = 0; n < frame->count; n++)
+        {
+            const RenderSprite* sprite = &frame->sprites[n];
+            DrawTexture(dummy, sprite->lastX + (sprite->x - sprite->lastX) * alpha,
+                        sprite->lastY + (sprite->y - sprite->lastY) * alpha, WHITE);
+        }
+
+        DrawFPS(10, 10);
+        DrawText(TextFormat("Processes: %d", frame->count), 10, 30, 20, WHITE);
+        DrawText(TextFormat("Dead cleaned: %d", frame->dead), 10, 50, 20, RED);
+
+        EndDrawing();
+        input->capture();
+    }
+
+    simulation_stop = true;
+    simulation.join();
+    return exit_value;
+}
+#else
+
+// Without a window run() is the headless loop, unbounded.
+u32 Interpreter::run()
+{
+    run_headless(0);
+    return exit_value;
+}
+
+#endif
+
+// Runs with no window: time comes from the clock source and input from the
+// input source, both set by the host. Stops after ticks ticks (0 means no
+// limit), on request_exit(), on an error, or once no process is alive.
+// Returns the number of ticks run.
+u32 Interpreter::run_headless(u32 ticks)
+{
+    must_exit = false;
+    u32 done = 0;
+    u64 last = time_source->now();
+    while (!must_exit && !panicMode && (ticks == 0 || done < ticks) && has_alive_processes())
+    {
+        input->poll();
+        u64 now = time_source->now();
+        accumulator += now - last;
+        last = now;
+
+        u32 steps = 0;
+        while (accumulator >= tick_length && steps < max_catchup && !must_exit && (ticks == 0 || done < ticks))
+        {
+            tick();
+            accumulator -= tick_length;
+            steps++;
+            done++;
+        }
+        if (accumulator >= tick_length)
+        {
+            accumulator %= tick_length;
+        }
+
+        if (accumulator < tick_length)
+        {
+            time_source->wait_until(now + tick_length - accumulator);
+        }
+    }
+    return done;
+}
+
+// Where the run loops read time from. nullptr restores the wall clock.
+void Interpreter::set_clock(Clock* source)
+{
+    time_source = source ? source : &system_clock;
+}
+
+// Where the input natives read from. nullptr means no input at all.
+void Interpreter::set_input(InputSource* source)
+{
+    input = source ? source : &no_input;
+}
+
  ObjFunction*  Interpreter::add_function(const char* name, u8 arity)
  {
      ObjFunction* function = new ObjFunction(name);
@@ -939,56 +1656,61 @@ void Interpreter::Info(const char *format, ...)
 
 bool Interpreter::registerVariable(const char *name, Value value)
 {
-     if (globals.contains(name))
+     GC.promote(&value);
+     GC.shade(value);
+     if (contains(name))
      {
         WARNING("Variable %s already defined", name);
          return false;
      }
-     globals.insert(name, std::move(value));
+     globals.insert(GC.intern(name, strlen(name)), std::move(value));
      return true;
 }
 
 bool Interpreter::registerNumber(const char *name, double value)
 {
-     if (globals.contains(name))
+     if (contains(name))
      {
         WARNING("Variable %s already defined", name);
          return false;
      }
-     globals.insert(name, std::move(NUMBER(value)));
+     globals.insert(GC.intern(name, strlen(name)), std::move(NUMBER(value)));
      return true;
 }
 
 bool Interpreter::registerInteger(const char *name, int value)
 {
-     if (globals.contains(name))
+     if (contains(name))
      {
         WARNING("Variable %s already defined", name);
          return false;
      }
-     globals.insert(name, std::move(INTEGER(value)));
+     globals.insert(GC.intern(name, strlen(name)), std::move(INTEGER(value)));
      return true;
 }
 
 bool Interpreter::registerString(const char *name, const char *value)
 {
-     if (globals.contains(name))
+     if (contains(name))
      {
         WARNING("Variable %s already defined", name);
          return false;
      }
-     globals.insert(name, std::move(STRING(value)));
+     Value string = STRING(value);
+     GC.promote(&string);
+     GC.shade(string);
+     globals.insert(GC.intern(name, strlen(name)), std::move(string));
      return true;
 }
 
 bool Interpreter::registerBoolean(const char *name, bool value)
 {
-     if (globals.contains(name))
+     if (contains(name))
      {
         WARNING("Variable %s already defined", name);
          return false;
      }
-     globals.insert(name, std::move(BOOLEAN(value)));
+     globals.insert(GC.intern(name, strlen(name)), std::move(BOOLEAN(value)));
      return true;
 }
 
@@ -1140,8 +1862,9 @@ ObjProcess::ObjProcess()
     
     strncpy(name, "Process", sizeof(name) - 1);
     name[sizeof(name) - 1] = '\0'; 
-    process = nullptr;
+    blueprint = nullptr;
     function = nullptr;
+    Memory.allocate(MEMORY_FUNCTIONS, sizeof(ObjProcess));
 }
 
 ObjProcess::ObjProcess(const String& n)  
@@ -1150,8 +1873,9 @@ ObjProcess::ObjProcess(const String& n)
      
     size_t len = n.length();
     memccpy(name, n.c_str(), '\0', len);
-    process = nullptr;
+    blueprint = nullptr;
     function = nullptr;
+    Memory.allocate(MEMORY_FUNCTIONS, sizeof(ObjProcess));
 }
 
 ObjProcess::ObjProcess(const char* n) 
@@ -1160,6 +1884,12 @@ ObjProcess::ObjProcess(const char* n)
     size_t len = strlen(n);
     memccpy(name, n, '\0', len);
 
-    process = nullptr;
+    blueprint = nullptr;
     function = nullptr;
+    Memory.allocate(MEMORY_FUNCTIONS, sizeof(ObjProcess));
+}
+
+ObjProcess::~ObjProcess()
+{
+    Memory.release(MEMORY_FUNCTIONS, sizeof(ObjProcess));
 }
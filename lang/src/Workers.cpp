@@ -0,0 +1,134 @@
+#include "Workers.hpp"
+
+
+WorkerPool::WorkerPool()
+{
+    threads = nullptr;
+    workerCount = 1;
+    batch = 0;
+    pending = 0;
+    quit = false;
+    task = nullptr;
+    context = nullptr;
+    for (u32 i = 0; i < MAX_WORKERS; i++)
+    {
+        slices[i].next.store(0, std::memory_order_relaxed);
+        slices[i].end = 0;
+    }
+}
+
+WorkerPool::~WorkerPool()
+{
+    stop();
+}
+
+// workers counts the calling thread, so start(4) spawns three threads.
+void WorkerPool::start(u32 workers)
+{
+    stop();
+    if (workers > MAX_WORKERS) workers = MAX_WORKERS;
+    if (workers <= 1) return;
+
+    // New threads start from batch 0; a count left from an earlier pool
+    // would look like a batch they have yet to run.
+    {
+        std::lock_guard<std::mutex> guard(mutex);
+        quit = false;
+        batch = 0;
+        pending = 0;
+    }
+    workerCount = workers;
+    threads = new std::thread[workers - 1];
+    for (u32 i = 1; i < workers; i++)
+    {
+        threads[i - 1] = std::thread(&WorkerPool::loop, this, i);
+    }
+}
+
+void WorkerPool::stop()
+{
+    if (!threads) return;
+
+    {
+        std::lock_guard<std::mutex> guard(mutex);
+        quit = true;
+    }
+    wake.notify_all();
+    for (u32 i = 1; i < workerCount; i++)
+    {
+        threads[i - 1].join();
+    }
+    delete[] threads;
+    threads = nullptr;
+    workerCount = 1;
+}
+
+void WorkerPool::run(u32 count, TaskFn task, void* context)
+{
+    if (count == 0) return;
+
+    if (workerCount == 1)
+    {
+        for (u32 i = 0; i < count; i++) task(context, i);
+        return;
+    }
+
+    u32 begin = 0;
+    for (u32 w = 0; w < workerCount; w++)
+    {
+        u32 end = (u32)((u64)count * (w + 1) / workerCount);
+        slices[w].next.store(begin, std::memory_order_relaxed);
+        slices[w].end = end;
+        begin = end;
+    }
+
+    {
+        std::lock_guard<std::mutex> guard(mutex);
+        this->task = task;
+        this->context = context;
+        pending = workerCount - 1;
+        batch++;
+    }
+    wake.notify_all();
+
+    work(0);
+
+    std::unique_lock<std::mutex> guard(mutex);
+    done.wait(guard, [this] { return pending == 0; });
+}
+
+void WorkerPool::loop(u32 worker)
+{
+    u64 seen = 0;
+    for (;;)
+    {
+        {
+            std::unique_lock<std::mutex> guard(mutex);
+            wake.wait(guard, [this, seen] { return quit || batch != seen; });
+            if (quit) return;
+            seen = batch;
+        }
+
+        work(worker);
+
+        std::lock_guard<std::mutex> guard(mutex);
+        if (--pending == 0) done.notify_one();
+    }
+}
+
+// Owner and thieves claim chunks the same way, with one fetch_add on the
+// slice cursor, so there is no separate steal path to get wrong.
+void WorkerPool::work(u32 worker)
+{
+    for (u32 n = 0; n < workerCount; n++)
+    {
+        Slice& slice = slices[(worker + n) % workerCount];
+        for (;;)
+        {
+            u32 first = slice.next.fetch_add(CHUNK, std::memory_order_relaxed);
+            if (first >= slice.end) break;
+            u32 last = first + CHUNK < slice.end ? first + CHUNK : slice.end;
+            for (u32 i = first; i < last; i++) task(context, i);
+        }
+    }
+}
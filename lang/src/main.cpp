@@ -6,8 +6,11 @@
 //#include "TestRai.hpp"
 //#include "TesteMap.hpp"
 
+#include <atomic>
 #include <cmath>
 #include <cstdlib>
+#include <mutex>
+#include <thread>
 #include <raylib.h>
 
 #include "Config.hpp"
@@ -71,89 +74,99 @@ void checkMemoryLeaks()
 #endif
 
 
-static Value clockNative(int argCount, Value* args) 
-{
-  return NUMBER((double)clock() / CLOCKS_PER_SEC);
-}
 
-static Value write_Native(int argCount, Value* args) 
-{
-  for (int i = 0; i < argCount; i++) 
-  {
-    PRINT_VALUE(args[i]);
-  }
 
-  return NIL();
-}
-static Value writeln_Native(int argCount, Value* args) 
+// Input natives read raylib through this. raylib's input state belongs to
+// the window thread and changes in EndDrawing(), so capture() copies it
+// there and poll() hands the copy to the ticks, which may run on the
+// simulation thread. Presses and releases pile up between polls, so a
+// tick sees every one even when several frames pass without ticks.
+class RaylibInput : public InputSource
 {
-  for (int i = 0; i < argCount; i++) 
-  {
-    PRINT_VALUE(args[i]);
-  }
-  printf("\n");
-  return NIL();
-}
+    static const int KEYS = 512;      // raylib's MAX_KEYBOARD_KEYS
+    static const int BUTTONS = 8;
 
+    enum { DOWN = 1, PRESSED = 2, RELEASED = 4 };
 
-static Value key_down_Native(int argCount, Value* args) 
-{
-  bool isDown = IsKeyDown(AS_INTEGER(args[0]));
-  return BOOLEAN(isDown);
-}
+    struct State
+    {
+        u8 keys[KEYS];
+        u8 buttons[BUTTONS];
+        int x;
+        int y;
+    };
 
-static Value key_pressed_Native(int argCount, Value* args) 
-{
-  bool isPressed = IsKeyPressed(AS_INTEGER(args[0]));
-  return BOOLEAN(isPressed);
-}
+    std::mutex lock;
+    State captured;   // window thread
+    State current;    // ticks
 
-static Value key_released_Native(int argCount, Value* args) 
-{
-  bool isReleased = IsKeyReleased(AS_INTEGER(args[0]));
-  return BOOLEAN(isReleased);
-}
+    static u8 edges(u8 old, bool down, bool pressed, bool released)
+    {
+        u8 state = old & (PRESSED | RELEASED);
+        if (down) state |= DOWN;
+        if (pressed) state |= PRESSED;
+        if (released) state |= RELEASED;
+        return state;
+    }
 
+    u8 key(int key) const { return key >= 0 && key < KEYS ? current.keys[key] : 0; }
+    u8 button(int button) const { return button >= 0 && button < BUTTONS ? current.buttons[button] : 0; }
 
-static Value key_up_Native(int argCount, Value* args) 
-{
-  bool isUp = IsKeyUp(AS_INTEGER(args[0]));
-  return BOOLEAN(isUp);
-}
+public:
+    RaylibInput()
+    {
+        memset(&captured, 0, sizeof(captured));
+        memset(&current, 0, sizeof(current));
+    }
 
-static Value mouse_x_Native(int argCount, Value* args)
-{
-  return NUMBER(GetMouseX());
-}
+    void capture() override
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        for (int k = 0; k < KEYS; k++)
+        {
+            captured.keys[k] = edges(captured.keys[k], IsKeyDown(k), IsKeyPressed(k), IsKeyReleased(k));
+        }
+        for (int b = 0; b < BUTTONS; b++)
+        {
+            captured.buttons[b] = edges(captured.buttons[b], IsMouseButtonDown(b),
+                                        IsMouseButtonPressed(b), IsMouseButtonReleased(b));
+        }
+        captured.x = GetMouseX();
+        captured.y = GetMouseY();
+    }
 
-static Value mouse_y_Native(int argCount, Value* args)
-{
-  return NUMBER(GetMouseY());
-}
+    void poll() override
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        current = captured;
+        for (int k = 0; k < KEYS; k++) captured.keys[k] &= DOWN;
+        for (int b = 0; b < BUTTONS; b++) captured.buttons[b] &= DOWN;
+    }
 
-static Value mouse_down_Native(int argCount, Value* args) 
-{
-  bool isDown = IsMouseButtonDown(AS_INTEGER(args[0]));
-  return BOOLEAN(isDown);
-}
+    bool key_down(int k) override { return key(k) & DOWN; }
+    bool key_pressed(int k) override { return key(k) & PRESSED; }
+    bool key_released(int k) override { return key(k) & RELEASED; }
+    bool mouse_down(int b) override { return button(b) & DOWN; }
+    bool mouse_pressed(int b) override { return button(b) & PRESSED; }
+    bool mouse_released(int b) override { return button(b) & RELEASED; }
+    int mouse_x() override { return current.x; }
+    int mouse_y() override { return current.y; }
+};
 
-static Value mouse_pressed_Native(int argCount, Value* args) 
-{
-  bool isPressed = IsMouseButtonPressed(AS_INTEGER(args[0]));
-  return BOOLEAN(isPressed);
-}
-
-static Value mouse_released_Native(int argCount, Value* args) 
-{
-  bool isReleased = IsMouseButtonReleased(AS_INTEGER(args[0]));
-  return BOOLEAN(isReleased);
-}
 
+// GL calls are only valid on the thread that owns the window. With a
+// render thread the ticks run elsewhere, and the draw natives do nothing.
+static std::thread::id window_thread;
+static std::atomic<bool> draw_warned(false);
 
-static Value mouse_up_Native(int argCount, Value* args) 
+static bool can_draw()
 {
-  bool isUp = IsMouseButtonUp(AS_INTEGER(args[0]));
-  return BOOLEAN(isUp);
+    if (std::this_thread::get_id() == window_thread) return true;
+    if (!draw_warned.exchange(true))
+    {
+        WARNING("Draw natives are ignored while rendering runs on its own thread");
+    }
+    return false;
 }
 
 
@@ -169,123 +182,50 @@ static Value set_color_Native(int argCount, Value* args)
 
 static Value darw_circle_Native(int argCount, Value* args) 
 {
+  if (!can_draw()) return NIL();
   DrawCircle(AS_INTEGER(args[0]), AS_INTEGER(args[1]), AS_INTEGER(args[2]), use_color);
   return NIL();
 }
 
 static Value darw_rectangle_Native(int argCount, Value* args) 
 {
+  if (!can_draw()) return NIL();
   DrawRectangle(AS_INTEGER(args[0]), AS_INTEGER(args[1]), AS_INTEGER(args[2]), AS_INTEGER(args[3]), use_color);
   return NIL();
 }
 
 static Value darw_line_Native(int argCount, Value* args) 
 {
+  if (!can_draw()) return NIL();
   DrawLine(AS_INTEGER(args[0]), AS_INTEGER(args[1]), AS_INTEGER(args[2]), AS_INTEGER(args[3]), use_color);
   return NIL();
 }
 
 static Value darw_text_Native(int argCount, Value* args) 
 {
-
+  if (!can_draw()) return NIL();
   ObjString* str = AS_STRING(args[0]);
   DrawText(str->data, AS_INTEGER(args[1]), AS_INTEGER(args[2]), AS_INTEGER(args[3]), use_color);
   return NIL();
 }
 
-// Random number generator (returns [0,1))
-Value rand_native(int argCount, Value* args) {
-    return NUMBER(static_cast<double>(std::rand()) / RAND_MAX);
-}
 
-#include <cstdlib>
 
-// Returns a double in [min, max]
-Value random_native(int argCount, Value* args) 
-{
-    if (argCount != 2 || !IS_NUMBER(args[0]) || !IS_NUMBER(args[1]))
-        return NIL();
 
-    double min = AS_NUMBER(args[0]);
-    double max = AS_NUMBER(args[1]);
 
-    if (min > max) 
-    {
-        double temp = min;
-        min = max;
-        max = temp;
-    }
-
-    // Generate a double in [0, 1)
-    double r = (double)std::rand() / ((double)RAND_MAX + 1.0);
-
-    // Scale to [min, max]
-    double result = min + r * (max - min);
 
-    return NUMBER(result);
-}
-
-
-// Absolute value
-Value abs_native(int argCount, Value* args) {
-    if (argCount != 1 || !IS_NUMBER(args[0])) return NIL();
-    return NUMBER(std::fabs(AS_NUMBER(args[0])));
-}
 
-// Sine function (radians)
-Value sin_native(int argCount, Value* args) {
-    if (argCount != 1 || !IS_NUMBER(args[0])) return NIL();
-    return NUMBER(std::sin(AS_NUMBER(args[0])));
-}
-
-// Cosine function (radians)
-Value cos_native(int argCount, Value* args) {
-    if (argCount != 1 || !IS_NUMBER(args[0])) return NIL();
-    return NUMBER(std::cos(AS_NUMBER(args[0])));
-}
-
-// Tangent function (radians)
-Value tan_native(int argCount, Value* args) {
-    if (argCount != 1 || !IS_NUMBER(args[0])) return NIL();
-    return NUMBER(std::tan(AS_NUMBER(args[0])));
-}
-
-
-
-
-
-
-int main()
+int main(int argc, char** argv)
 {
 
  
 
    Interpreter vm;
 
-   vm.defineNative("clock", clockNative);
-   vm.defineNative("write", write_Native  );
-   vm.defineNative("writeln", writeln_Native);
-
-
-   vm.defineNative("rand", rand_native);
-   vm.defineNative("random", random_native);
-   vm.defineNative("abs", abs_native);
-   vm.defineNative("sin", sin_native);
-   vm.defineNative("cos", cos_native);
-   vm.defineNative("tan", tan_native);
-
-   vm.defineNative("key_down", key_down_Native);
-   vm.defineNative("key_pressed", key_pressed_Native);
-   vm.defineNative("key_released", key_released_Native);
-   vm.defineNative("key_up", key_up_Native);
-
-   vm.defineNative("mouse_down", mouse_down_Native);
-   vm.defineNative("mouse_pressed", mouse_pressed_Native);
-   vm.defineNative("mouse_released", mouse_released_Native);
-   vm.defineNative("mouse_up", mouse_up_Native);
-
-   vm.defineNative("mouse_x", mouse_x_Native);
-   vm.defineNative("mouse_y", mouse_y_Native);
+   RaylibInput input;
+   vm.set_input(&input);
+   vm.defineStandardNatives();
+   vm.defineInputNatives();
 
    vm.defineNative("set_color", set_color_Native);
    vm.defineNative("draw_circle", darw_circle_Native);
@@ -298,12 +238,14 @@ int main()
   const int screenHeight = 450;
 
   InitWindow(screenWidth, screenHeight, "BuEngine");
+  window_thread = std::this_thread::get_id();
   SetTargetFPS(60);
       dummy = LoadTexture("assets/wabbit_alpha.png");
  
 
 
-  if (vm.compile_file("main.bu"))
+  const char* script = argc > 1 ? argv[1] : "main.bu";
+  if (vm.compile_file(script))
   {
 
 